@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /* for aligned_alloc */
 #ifndef __USE_ISOC11
@@ -69,6 +70,20 @@
         }                                                                \
     } while (0)
 
+#define VG_LITE_RETURN_ERROR(func)                 \
+    do {                                           \
+        vg_lite_error_t error_code = func;         \
+        if (VG_LITE_IS_ERROR(error_code)) {        \
+            return error_code;                     \
+        }                                          \
+    } while (0)
+
+#define REGRESSION_TARGET_COLOR 0xC0306090
+#define REGRESSION_SOURCE_COLOR 0x80FF8040
+#define REGRESSION_PATTERN_COLOR 0xFF4080C0
+#define REGRESSION_BACKGROUND_COLOR 0xFF000000
+#define REGRESSION_SCISSOR_COLOR 0xFF0000FF
+
 #define VG_LITE_ALIGN(number, align_bytes) \
     (((number) + ((align_bytes) - 1)) & ~((align_bytes) - 1))
 
@@ -109,8 +124,30 @@ typedef struct
     vg_lite_color_t pattern_color;
     vg_lite_color_t target_color;
     vg_lite_color_t source_color;
+
+    int iterations;
 } vg_lite_context_t;
 
+typedef struct
+{
+    const char* name;
+
+    /* Draws the case into the target, the paths at the given quality. */
+    vg_lite_error_t (*draw)(vg_lite_context_t* context, int param, vg_lite_quality_t quality);
+
+    /* Checks the target against the expected pixels, NULL for a timing only case. */
+    bool (*check)(vg_lite_context_t* context, int param);
+
+    int param;
+
+    /* The case is drawn at each quality, else only once. */
+    bool tiered;
+
+    /* Pixels allowed to differ from the VG_LITE_HIGH draw, per pixel of the target width plus height,
+     * -1 to skip the comparison. */
+    int edge_budget;
+} vg_lite_regression_case_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
@@ -118,6 +155,7 @@ typedef struct
 static void vg_lite_context_init(vg_lite_context_t* context);
 static void vg_lite_context_deinit(vg_lite_context_t* context);
 static void vg_lite_run_test(vg_lite_context_t* context);
+static void vg_lite_run_regression(vg_lite_context_t* context);
 static int parse_commandline(int argc, char** argv, vg_lite_context_t* context);
 static const char* vg_lite_error_string(vg_lite_error_t error);
 static bool save_buffer(const char* filename, const vg_lite_buffer_t* buffer);
@@ -128,6 +166,11 @@ static vg_lite_error_t free_buffer(vg_lite_buffer_t* buffer);
  *  STATIC VARIABLES
  **********************/
 
+/* The buffers and paths of the regression cases */
+static vg_lite_buffer_t regression_texture;
+static vg_lite_path_t regression_rect_path;
+static vg_lite_path_t* regression_tiger_paths;
+
 /**********************
  *      MACROS
  **********************/
@@ -216,6 +259,7 @@ static void vg_lite_context_init(vg_lite_context_t* context)
     context->fill_rule = VG_LITE_FILL_EVEN_ODD;
     context->filter = VG_LITE_FILTER_BI_LINEAR;
     context->pattern_mode = VG_LITE_PATTERN_COLOR;
+    context->iterations = 10;
 
     vg_lite_init_path(
         &context->path,
@@ -299,6 +343,8 @@ static void vg_lite_run_test(vg_lite_context_t* context)
             context->pattern_color,
             context->color,
             context->filter));
+    } else if (IS_STR_EQUAL(context->func_name, "vg_lite_regression")) {
+        vg_lite_run_regression(context);
     } else {
         printf(VG_LITE_PREFIX "Unknown function name: %s\n", context->func_name);
     }
@@ -309,6 +355,600 @@ error_handler:
     printf(VG_LITE_PREFIX "Test finished\n");
 }
 
+static const int16_t regression_rect_data[] = {
+    VLC_OP_MOVE, 0, 0,
+    VLC_OP_LINE, 1, 0,
+    VLC_OP_LINE, 1, 1,
+    VLC_OP_LINE, 0, 1,
+    VLC_OP_CLOSE,
+    VLC_OP_END
+};
+
+static double get_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static const char* vg_lite_quality_string(vg_lite_quality_t quality)
+{
+    switch (quality) {
+        ENUM_TO_STRING(VG_LITE_HIGH);
+        ENUM_TO_STRING(VG_LITE_UPPER);
+        ENUM_TO_STRING(VG_LITE_MEDIUM);
+        ENUM_TO_STRING(VG_LITE_LOW);
+    default:
+        break;
+    }
+    return "-";
+}
+
+static uint32_t regression_get_pixel(const vg_lite_buffer_t* buffer, int x, int y)
+{
+    return ((const uint32_t*)((const uint8_t*)buffer->memory + y * buffer->stride))[x];
+}
+
+static uint32_t regression_color_to_pixel(vg_lite_color_t color)
+{
+    /* AABBGGRR to the BGRA8888 memory order */
+    return (color & 0xFF00FF00) | ((color & 0xFF) << 16) | ((color >> 16) & 0xFF);
+}
+
+static int regression_mul(int a, int b)
+{
+    return (a * b + 127) / 255;
+}
+
+static uint32_t regression_premultiply(uint32_t pixel)
+{
+    int alpha = pixel >> 24;
+    uint32_t out = pixel & 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        out |= (uint32_t)regression_mul((pixel >> shift) & 0xFF, alpha) << shift;
+    }
+    return out;
+}
+
+static bool regression_pixel_equal(uint32_t a, uint32_t b, int tolerance)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        int diff = (int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF);
+        if (diff > tolerance || diff < -tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool regression_check_pixel(const vg_lite_buffer_t* buffer, int x, int y, uint32_t expected, int tolerance)
+{
+    uint32_t pixel = regression_get_pixel(buffer, x, y);
+    if (!regression_pixel_equal(pixel, expected, tolerance)) {
+        printf(VG_LITE_PREFIX "  pixel (%d, %d): 0x%08X, expected 0x%08X\n", x, y, pixel, expected);
+        return false;
+    }
+    return true;
+}
+
+static bool regression_blend_is_lvgl(vg_lite_blend_t blend)
+{
+    return blend == VG_LITE_BLEND_SUBTRACT_LVGL
+        || blend == VG_LITE_BLEND_NORMAL_LVGL
+        || blend == VG_LITE_BLEND_ADDITIVE_LVGL
+        || blend == VG_LITE_BLEND_MULTIPLY_LVGL;
+}
+
+static uint32_t regression_blend(vg_lite_blend_t blend, uint32_t src, uint32_t dest)
+{
+    /* The formulas of vg_lite.h on premultiplied pixels, the alpha of the LVGL modes is source over. */
+    int sa = src >> 24;
+    int da = dest >> 24;
+    uint32_t out = 0;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        int s = (src >> shift) & 0xFF;
+        int d = (dest >> shift) & 0xFF;
+        int r;
+
+        switch (shift == 24 && regression_blend_is_lvgl(blend) ? VG_LITE_BLEND_SRC_OVER : blend) {
+        case VG_LITE_BLEND_DST_OVER:
+            r = regression_mul(s, 255 - da) + d;
+            break;
+        case VG_LITE_BLEND_SRC_IN:
+            r = regression_mul(s, da);
+            break;
+        case VG_LITE_BLEND_DST_IN:
+            r = regression_mul(d, sa);
+            break;
+        case VG_LITE_BLEND_MULTIPLY:
+            r = regression_mul(s, 255 - da) + regression_mul(d, 255 - sa) + regression_mul(s, d);
+            break;
+        case VG_LITE_BLEND_SCREEN:
+            r = s + d - regression_mul(s, d);
+            break;
+        case VG_LITE_BLEND_DARKEN:
+        case VG_LITE_BLEND_LIGHTEN: {
+            int src_over = s + regression_mul(d, 255 - sa);
+            int dst_over = d + regression_mul(s, 255 - da);
+            r = (blend == VG_LITE_BLEND_DARKEN) == (src_over < dst_over) ? src_over : dst_over;
+        } break;
+        case VG_LITE_BLEND_ADDITIVE:
+        case VG_LITE_BLEND_ADDITIVE_LVGL:
+            r = s + d;
+            break;
+        case VG_LITE_BLEND_SUBTRACT:
+            r = regression_mul(d, 255 - sa);
+            break;
+        case VG_LITE_BLEND_SUBTRACT_LVGL:
+            r = d - s;
+            break;
+        case VG_LITE_BLEND_MULTIPLY_LVGL:
+            r = regression_mul(s, d) + regression_mul(d, 255 - sa);
+            break;
+        default:
+            r = s + regression_mul(d, 255 - sa);
+            break;
+        }
+
+        r = r < 0 ? 0 : r > 255 ? 255 : r;
+        out |= (uint32_t)r << shift;
+    }
+
+    return out;
+}
+
+static uint32_t regression_texel(int x, int y)
+{
+    return 0xFF000080 | ((uint32_t)(0x20 + 0x40 * x) << 16) | ((uint32_t)(0x20 + 0x40 * y) << 8);
+}
+
+static vg_lite_error_t regression_draw_rect(vg_lite_context_t* context, vg_lite_blend_t blend, vg_lite_color_t color,
+    vg_lite_quality_t quality)
+{
+    /* the unit square stretched over the whole target */
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+    vg_lite_scale((vg_lite_float_t)context->target.width, (vg_lite_float_t)context->target.height, &matrix);
+
+    regression_rect_path.quality = quality;
+    return vg_lite_draw(&context->target, &regression_rect_path, VG_LITE_FILL_NON_ZERO, &matrix, blend, color);
+}
+
+static vg_lite_float_t regression_triangle_scale(const vg_lite_context_t* context)
+{
+    int size = context->target.width < context->target.height ? context->target.width : context->target.height;
+    return (vg_lite_float_t)(size - 40) / 100.0f;
+}
+
+static vg_lite_error_t regression_draw_triangle(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    VG_LITE_RETURN_ERROR(vg_lite_clear(&context->target, NULL, REGRESSION_TARGET_COLOR));
+
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+    vg_lite_translate(20, 20, &matrix);
+    vg_lite_scale(regression_triangle_scale(context), regression_triangle_scale(context), &matrix);
+
+    context->path.quality = quality;
+    return vg_lite_draw(&context->target, &context->path, VG_LITE_FILL_NON_ZERO, &matrix,
+        VG_LITE_BLEND_SRC_OVER, context->color);
+}
+
+static bool regression_check_triangle(vg_lite_context_t* context, int param)
+{
+    /* one point well inside the triangle of custom_path_data and one well outside */
+    vg_lite_float_t scale = regression_triangle_scale(context);
+    uint32_t dest = regression_color_to_pixel(REGRESSION_TARGET_COLOR);
+    uint32_t src = regression_premultiply(regression_color_to_pixel(context->color));
+    bool passed = true;
+
+    passed &= regression_check_pixel(&context->target, 20 + (int)(20 * scale), 20 + (int)(70 * scale),
+        regression_blend(VG_LITE_BLEND_SRC_OVER, src, dest), 2);
+    passed &= regression_check_pixel(&context->target, 20 + (int)(70 * scale), 20 + (int)(20 * scale), dest, 0);
+    return passed;
+}
+
+static vg_lite_error_t regression_draw_tiger(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    VG_LITE_RETURN_ERROR(vg_lite_clear(&context->target, NULL, REGRESSION_BACKGROUND_COLOR));
+
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+    vg_lite_translate(150, 150, &matrix);
+    vg_lite_scale(3, 3, &matrix);
+
+    for (int i = 0; i < sizeof(tiger_paths) / sizeof(vg_lite_path_t); i++) {
+        regression_tiger_paths[i].quality = quality;
+        VG_LITE_RETURN_ERROR(vg_lite_draw(
+            &context->target,
+            &regression_tiger_paths[i],
+            VG_LITE_FILL_EVEN_ODD,
+            &matrix,
+            VG_LITE_BLEND_SRC_OVER,
+            tiger_color_data[i]));
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+static vg_lite_error_t regression_draw_blend(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    vg_lite_blend_t blend = (vg_lite_blend_t)param;
+    if (regression_blend_is_lvgl(blend) && !vg_lite_query_feature(gcFEATURE_BIT_VG_LVGL_SUPPORT)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    VG_LITE_RETURN_ERROR(vg_lite_clear(&context->target, NULL, REGRESSION_TARGET_COLOR));
+    return regression_draw_rect(context, blend, REGRESSION_SOURCE_COLOR, quality);
+}
+
+static bool regression_check_blend(vg_lite_context_t* context, int param)
+{
+    uint32_t src = regression_premultiply(regression_color_to_pixel(REGRESSION_SOURCE_COLOR));
+    uint32_t dest = regression_color_to_pixel(REGRESSION_TARGET_COLOR);
+    uint32_t expected = regression_blend((vg_lite_blend_t)param, src, dest);
+    int right = context->target.width - 1;
+    int bottom = context->target.height - 1;
+    bool passed = true;
+
+    passed &= regression_check_pixel(&context->target, 0, 0, expected, 2);
+    passed &= regression_check_pixel(&context->target, right / 2, bottom / 2, expected, 2);
+    passed &= regression_check_pixel(&context->target, right, bottom, expected, 2);
+    return passed;
+}
+
+static vg_lite_error_t regression_draw_pattern(vg_lite_context_t* context, vg_lite_pattern_mode_t mode,
+    vg_lite_filter_t filter, vg_lite_quality_t quality)
+{
+    if ((mode == VG_LITE_PATTERN_REPEAT || mode == VG_LITE_PATTERN_REFLECT)
+        && !vg_lite_query_feature(gcFEATURE_BIT_VG_IM_REPEAT_REFLECT)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    VG_LITE_RETURN_ERROR(vg_lite_clear(&context->target, NULL, REGRESSION_BACKGROUND_COLOR));
+
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+    vg_lite_scale((vg_lite_float_t)context->target.width, (vg_lite_float_t)context->target.height, &matrix);
+
+    /* each texel of the 4x4 texture covers 9x9 pixels, the center of each texel is a pixel center */
+    vg_lite_matrix_t pattern_matrix;
+    vg_lite_identity(&pattern_matrix);
+    vg_lite_translate(16, 16, &pattern_matrix);
+    vg_lite_scale(9, 9, &pattern_matrix);
+
+    regression_rect_path.quality = quality;
+    return vg_lite_draw_pattern(
+        &context->target,
+        &regression_rect_path,
+        VG_LITE_FILL_NON_ZERO,
+        &matrix,
+        &regression_texture,
+        &pattern_matrix,
+        VG_LITE_BLEND_SRC_OVER,
+        mode,
+        REGRESSION_PATTERN_COLOR,
+        0,
+        filter);
+}
+
+static vg_lite_error_t regression_draw_filter(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    return regression_draw_pattern(context, VG_LITE_PATTERN_PAD, (vg_lite_filter_t)param, quality);
+}
+
+static bool regression_check_filter(vg_lite_context_t* context, int param)
+{
+    /* the filters read exactly the texel at its center */
+    bool passed = true;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            passed &= regression_check_pixel(&context->target, 20 + 9 * x, 20 + 9 * y, regression_texel(x, y), 1);
+        }
+    }
+    return passed;
+}
+
+static vg_lite_error_t regression_draw_wrap(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    return regression_draw_pattern(context, (vg_lite_pattern_mode_t)param, VG_LITE_FILTER_POINT, quality);
+}
+
+static bool regression_check_wrap(vg_lite_context_t* context, int param)
+{
+    /**
+     * Pixel 4 falls in texel column -2 and pixel 70 in column 6, on the first row.
+     * Both are column 2 once repeated, 1 once reflected.
+     */
+    uint32_t left, right;
+    switch (param) {
+    case VG_LITE_PATTERN_PAD:
+        left = regression_texel(0, 0);
+        right = regression_texel(3, 0);
+        break;
+    case VG_LITE_PATTERN_REPEAT:
+        left = right = regression_texel(2, 0);
+        break;
+    case VG_LITE_PATTERN_REFLECT:
+        left = right = regression_texel(1, 0);
+        break;
+    default:
+        left = right = regression_color_to_pixel(REGRESSION_PATTERN_COLOR);
+        break;
+    }
+
+    bool passed = true;
+    passed &= regression_check_pixel(&context->target, 20, 20, regression_texel(0, 0), 0);
+    passed &= regression_check_pixel(&context->target, 4, 20, left, 0);
+    passed &= regression_check_pixel(&context->target, 70, 20, right, 0);
+    return passed;
+}
+
+static void regression_copy_offsets(int param, int* sx, int* sy, int* dx, int* dy)
+{
+    /* the rectangles overlap, the copy moves forward or backward in memory */
+    *sx = param ? 8 : 0;
+    *sy = param ? 4 : 0;
+    *dx = param ? 0 : 8;
+    *dy = param ? 0 : 4;
+}
+
+static vg_lite_error_t regression_draw_copy(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    for (int y = 0; y < 64; y++) {
+        uint32_t* row = (uint32_t*)((uint8_t*)context->target.memory + y * context->target.stride);
+        for (int x = 0; x < 64; x++) {
+            row[x] = 0xFF000000 | (y << 8) | x;
+        }
+    }
+    CACHE_FLUSH();
+
+    int sx, sy, dx, dy;
+    regression_copy_offsets(param, &sx, &sy, &dx, &dy);
+    return vg_lite_copy_image(&context->target, &context->target, sx, sy, dx, dy, 32, 32);
+}
+
+static bool regression_check_copy(vg_lite_context_t* context, int param)
+{
+    int sx, sy, dx, dy;
+    regression_copy_offsets(param, &sx, &sy, &dx, &dy);
+
+    /* the pixels as they were before the copy, like memmove() */
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            uint32_t expected = 0xFF000000 | ((sy + y) << 8) | (sx + x);
+            if (!regression_check_pixel(&context->target, dx + x, dy + y, expected, 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static vg_lite_error_t regression_draw_scissor(vg_lite_context_t* context, int param, vg_lite_quality_t quality)
+{
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_SCISSOR)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    VG_LITE_RETURN_ERROR(vg_lite_clear(&context->target, NULL, REGRESSION_BACKGROUND_COLOR));
+
+    vg_lite_rectangle_t rects[] = {
+        { 10, 10, 20, 20 },
+        { 50, 30, 10, 40 },
+    };
+    VG_LITE_RETURN_ERROR(vg_lite_scissor_rects(sizeof(rects) / sizeof(rects[0]), rects));
+    VG_LITE_RETURN_ERROR(vg_lite_enable_scissor());
+
+    vg_lite_error_t error = regression_draw_rect(context, VG_LITE_BLEND_SRC_OVER, REGRESSION_SCISSOR_COLOR, quality);
+
+    VG_LITE_RETURN_ERROR(vg_lite_disable_scissor());
+    return error;
+}
+
+static bool regression_check_scissor(vg_lite_context_t* context, int param)
+{
+    uint32_t inside = regression_color_to_pixel(REGRESSION_SCISSOR_COLOR);
+    uint32_t outside = regression_color_to_pixel(REGRESSION_BACKGROUND_COLOR);
+    bool passed = true;
+
+    passed &= regression_check_pixel(&context->target, 10, 10, inside, 0);
+    passed &= regression_check_pixel(&context->target, 29, 29, inside, 0);
+    passed &= regression_check_pixel(&context->target, 55, 69, inside, 0);
+    passed &= regression_check_pixel(&context->target, 9, 10, outside, 0);
+    passed &= regression_check_pixel(&context->target, 30, 15, outside, 0);
+    passed &= regression_check_pixel(&context->target, 40, 40, outside, 0);
+    passed &= regression_check_pixel(&context->target, 55, 70, outside, 0);
+    return passed;
+}
+
+#define REGRESSION_BLEND_CASE(blend) \
+    { #blend, regression_draw_blend, regression_check_blend, blend, true, 0 }
+
+static const vg_lite_regression_case_t regression_cases[] = {
+    { "tiger", regression_draw_tiger, NULL, 0, true, -1 },
+    { "triangle", regression_draw_triangle, regression_check_triangle, 0, true, 2 },
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_SRC_OVER),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_DST_OVER),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_SRC_IN),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_DST_IN),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_MULTIPLY),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_SCREEN),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_DARKEN),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_LIGHTEN),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_ADDITIVE),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_SUBTRACT),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_SUBTRACT_LVGL),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_NORMAL_LVGL),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_ADDITIVE_LVGL),
+    REGRESSION_BLEND_CASE(VG_LITE_BLEND_MULTIPLY_LVGL),
+    { "VG_LITE_FILTER_POINT", regression_draw_filter, regression_check_filter, VG_LITE_FILTER_POINT, true, 0 },
+    { "VG_LITE_FILTER_BI_LINEAR", regression_draw_filter, regression_check_filter, VG_LITE_FILTER_BI_LINEAR, true, 0 },
+    { "VG_LITE_PATTERN_COLOR", regression_draw_wrap, regression_check_wrap, VG_LITE_PATTERN_COLOR, true, 0 },
+    { "VG_LITE_PATTERN_PAD", regression_draw_wrap, regression_check_wrap, VG_LITE_PATTERN_PAD, true, 0 },
+    { "VG_LITE_PATTERN_REPEAT", regression_draw_wrap, regression_check_wrap, VG_LITE_PATTERN_REPEAT, true, 0 },
+    { "VG_LITE_PATTERN_REFLECT", regression_draw_wrap, regression_check_wrap, VG_LITE_PATTERN_REFLECT, true, 0 },
+    { "copy forward", regression_draw_copy, regression_check_copy, 0, false, -1 },
+    { "copy backward", regression_draw_copy, regression_check_copy, 1, false, -1 },
+    { "scissor rects", regression_draw_scissor, regression_check_scissor, 0, true, 0 },
+};
+
+static int regression_count_diff(const vg_lite_buffer_t* buffer, const uint8_t* reference)
+{
+    /* the pixels with a channel more than a quarter off */
+    int count = 0;
+    for (int y = 0; y < buffer->height; y++) {
+        const uint32_t* ref_row = (const uint32_t*)(reference + y * buffer->stride);
+        for (int x = 0; x < buffer->width; x++) {
+            if (!regression_pixel_equal(regression_get_pixel(buffer, x, y), ref_row[x], 0x40)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static int regression_run_case(vg_lite_context_t* context, const vg_lite_regression_case_t* item,
+    vg_lite_quality_t quality, uint8_t* reference)
+{
+    /* Returns 1 if the case passed, 0 if it failed and -1 if it is not supported. */
+    const char* quality_name = item->tiered ? vg_lite_quality_string(quality) : "-";
+
+    vg_lite_error_t error = item->draw(context, item->param, quality);
+    if (error == VG_LITE_NOT_SUPPORT) {
+        printf(VG_LITE_PREFIX "SKIP %-28s %-14s\n", item->name, quality_name);
+        return -1;
+    }
+
+    if (!VG_LITE_IS_ERROR(error)) {
+        error = vg_lite_finish();
+    }
+
+    if (VG_LITE_IS_ERROR(error)) {
+        printf(VG_LITE_PREFIX "FAIL %-28s %-14s error: %d(%s)\n",
+            item->name, quality_name, (int)error, vg_lite_error_string(error));
+        return 0;
+    }
+
+    CACHE_INVALIDATE();
+
+    /* the first draw is checked, the following ones are only timed */
+    bool passed = item->check ? item->check(context, item->param) : true;
+    bool compared = item->tiered && item->edge_budget >= 0 && quality != VG_LITE_HIGH;
+    int diff = 0;
+
+    if (item->tiered && item->edge_budget >= 0) {
+        if (quality == VG_LITE_HIGH) {
+            memcpy(reference, context->target.memory, context->target.height * context->target.stride);
+        } else {
+            diff = regression_count_diff(&context->target, reference);
+            if (diff > item->edge_budget * (context->target.width + context->target.height)) {
+                passed = false;
+            }
+        }
+    }
+
+    double start = get_time_us();
+    for (int i = 0; i < context->iterations && !VG_LITE_IS_ERROR(error); i++) {
+        error = item->draw(context, item->param, quality);
+        if (!VG_LITE_IS_ERROR(error)) {
+            error = vg_lite_finish();
+        }
+    }
+    double elapsed = (get_time_us() - start) / context->iterations;
+
+    const char* result = item->check || item->edge_budget >= 0 ? (passed ? "PASS" : "FAIL") : "TIME";
+    printf(VG_LITE_PREFIX "%s %-28s %-14s %10.1f us", result, item->name, quality_name, elapsed);
+    if (compared) {
+        printf(", %d pixels off VG_LITE_HIGH", diff);
+    }
+    printf("\n");
+
+    return passed ? 1 : 0;
+}
+
+static void vg_lite_run_regression(vg_lite_context_t* context)
+{
+    static const vg_lite_quality_t qualities[] = {
+        VG_LITE_HIGH,
+        VG_LITE_UPPER,
+        VG_LITE_MEDIUM,
+        VG_LITE_LOW,
+    };
+
+    if (context->target.format != VG_LITE_BGRA8888 || context->target.width < 80 || context->target.height < 80) {
+        printf(VG_LITE_PREFIX "Regression needs a VG_LITE_BGRA8888 target of at least 80x80\n");
+        return;
+    }
+
+    int passed = 0;
+    int failed = 0;
+    int skipped = 0;
+
+    /* the cases set their own scissor */
+    VG_LITE_CHECK_ERROR(vg_lite_disable_scissor());
+
+    VG_LITE_CHECK_ERROR(vg_lite_init_path(
+        &regression_rect_path,
+        VG_LITE_S16,
+        VG_LITE_HIGH,
+        sizeof(regression_rect_data),
+        (void*)regression_rect_data,
+        0, 0, 1, 1));
+
+    memset(&regression_texture, 0, sizeof(regression_texture));
+    regression_texture.format = VG_LITE_BGRA8888;
+    regression_texture.width = 4;
+    regression_texture.height = 4;
+    VG_LITE_CHECK_ERROR(alloc_buffer(&regression_texture));
+
+    for (int y = 0; y < 4; y++) {
+        uint32_t* row = (uint32_t*)((uint8_t*)regression_texture.memory + y * regression_texture.stride);
+        for (int x = 0; x < 4; x++) {
+            row[x] = regression_texel(x, y);
+        }
+    }
+    CACHE_FLUSH();
+
+    regression_tiger_paths = malloc(sizeof(tiger_paths));
+    LV_ASSERT(regression_tiger_paths);
+    memcpy(regression_tiger_paths, tiger_paths, sizeof(tiger_paths));
+
+    uint8_t* reference = malloc(context->target.height * context->target.stride);
+    LV_ASSERT(reference);
+
+    printf(VG_LITE_PREFIX "Running %d regression cases, %d timed draws each\n",
+        (int)(sizeof(regression_cases) / sizeof(regression_cases[0])), context->iterations);
+
+    for (int i = 0; i < sizeof(regression_cases) / sizeof(regression_cases[0]); i++) {
+        const vg_lite_regression_case_t* item = &regression_cases[i];
+        int count = item->tiered ? sizeof(qualities) / sizeof(qualities[0]) : 1;
+
+        for (int j = 0; j < count; j++) {
+            int result = regression_run_case(context, item, qualities[j], reference);
+            if (result > 0) {
+                passed++;
+            } else if (result == 0) {
+                failed++;
+            } else {
+                skipped++;
+            }
+        }
+    }
+
+    printf(VG_LITE_PREFIX "Regression: %d passed, %d failed, %d skipped\n", passed, failed, skipped);
+
+    free(reference);
+    free(regression_tiger_paths);
+    regression_tiger_paths = NULL;
+
+error_handler:
+    if (regression_texture.memory) {
+        free_buffer(&regression_texture);
+    }
+}
+
 static void show_usage(const char* progname)
 {
     printf("\nUsage: %s"
@@ -329,6 +969,7 @@ static void show_usage(const char* progname)
            " --pattern-color <hex-value>"
            " --source-color <hex-value>\n"
            " --scissor <string>"
+           " --iterations <number>"
            "\n",
         progname);
 
@@ -336,7 +977,8 @@ static void show_usage(const char* progname)
     printf("  -h Show this help message.\n");
     printf("  -o <string> Output file path. Use file extension to determine the output format. \n"
            "              i.e. 'target.png' for PNG format(default). Others formats are save raw data.\n");
-    printf("  --func <string> Test case function name.\n");
+    printf("  --func <string> Test case function name.\n"
+           "                  'vg_lite_regression' checks and times the drawing paths at each quality.\n");
     printf("  --target <string> Target buffer arguments in the format of 'width,height,format'.\n");
     printf("  --source <string> Source buffer arguments in the format of 'width,height,format'.\n");
     printf("  --matrix <string> Matrix arguments in the format of 'm[3][3]' (e.g. '1,0,0,0,1,0,0,0,1').\n");
@@ -351,6 +993,7 @@ static void show_usage(const char* progname)
     printf("  --pattern-color <hex-value> Pattern Color in the format of 'AABBGGRR'.\n");
     printf("  --source-color <hex-value> Source color in the format of 'AABBGGRR'.\n");
     printf("  --scissor <string> Scissor area arguments in the format of 'x,y,right,bottom' (e.g. '0,0,100,100').\n");
+    printf("  --iterations <number> Number of timed draws of each regression case.\n");
 }
 
 static const char* vg_lite_error_string(vg_lite_error_t error)
@@ -647,6 +1290,14 @@ static int parse_long_commandline(int longindex, const struct option* longopts,
         retval = parse_scissor_args(optarg);
         break;
 
+    case 16:
+        context->iterations = atoi(optarg);
+        if (context->iterations <= 0) {
+            printf(VG_LITE_PREFIX "Invalid iterations: %s\n", optarg);
+            retval = -1;
+        }
+        break;
+
     default:
         printf(VG_LITE_PREFIX "Unknown longindex: %d\n", longindex);
         return -1;
@@ -678,6 +1329,7 @@ static int parse_commandline(int argc, char** argv, vg_lite_context_t* context)
         { "target-color", required_argument, NULL, 0 },
         { "source-color", required_argument, NULL, 0 },
         { "scissor", required_argument, NULL, 0 },
+        { "iterations", required_argument, NULL, 0 },
         { 0, 0, NULL, 0 }
     };
 
@@ -69,4 +69,44 @@ static inline void* lv_malloc_zeroed(size_t size)
 /*Enable multi-thread render*/
 #define LV_VG_LITE_THORVG_THREAD_RENDER 0
 
+/*Render LOW and MEDIUM quality fills with the built-in scanline rasterizer*/
+#ifndef LV_VG_LITE_THORVG_QUALITY_TIERS
+#define LV_VG_LITE_THORVG_QUALITY_TIERS 1
+#endif
+
+/*Number of simplified paths kept for reuse across frames*/
+#ifndef LV_VG_LITE_THORVG_LOD_CACHE_CNT
+#define LV_VG_LITE_THORVG_LOD_CACHE_CNT 256
+#endif
+
+/*Maximum width of a gradient ramp image, wider ramps are resampled*/
+#ifndef LV_VG_LITE_THORVG_GRAD_RAMP_MAX_WIDTH
+#define LV_VG_LITE_THORVG_GRAD_RAMP_MAX_WIDTH 1024
+#endif
+
+/*Number of gradient ramps kept for the gradients with the same stops, and of converted gradient fills, 0 to disable*/
+#ifndef LV_VG_LITE_THORVG_GRAD_CACHE_CNT
+#define LV_VG_LITE_THORVG_GRAD_CACHE_CNT 16
+#endif
+
+/*Memory budget in bytes of the mipmaps of down-scaled blit sources, 0 to disable*/
+#ifndef LV_VG_LITE_THORVG_MIP_CACHE_SIZE
+#define LV_VG_LITE_THORVG_MIP_CACHE_SIZE (1024 * 1024)
+#endif
+
+/*Bytes of the released buffers kept by vg_lite_allocate() for reuse*/
+#ifndef LV_VG_LITE_THORVG_MEM_POOL_CACHE_SIZE
+#define LV_VG_LITE_THORVG_MEM_POOL_CACHE_SIZE (4 * 1024 * 1024)
+#endif
+
+/*Memory budget in bytes of the allocated and the kept buffers, 0 for no limit*/
+#ifndef LV_VG_LITE_THORVG_MEM_BUDGET
+#define LV_VG_LITE_THORVG_MEM_BUDGET 0
+#endif
+
+/*Synchronize the CPU access to the dma-buf fds of vg_lite_map(), needs the Linux dma-buf headers*/
+#ifndef LV_VG_LITE_THORVG_DMABUF_SUPPORT
+#define LV_VG_LITE_THORVG_DMABUF_SUPPORT 0
+#endif
+
 #endif /* VG_LITE_CONF_H */
@@ -25,12 +25,25 @@
 *
 *****************************************************************************/
 
+#include <float.h>
 #include <math.h>
 #include <string.h>
 #include "vg_lite.h"
+#include "vg_lite_matrix.h"
 
 #define VG_SW_BLIT_PRECISION_OPT 1
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VG_MATRIX_NEON 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VG_MATRIX_SSE 1
+#endif
+
+#define IS_AFFINE(matrix) \
+    ((matrix)->m[2][0] == 0.0f && (matrix)->m[2][1] == 0.0f && (matrix)->m[2][2] == 1.0f)
+
 vg_lite_error_t vg_lite_identity(vg_lite_matrix_t * matrix)
 {
     /* Set identify matrix. */
@@ -79,32 +92,25 @@ static void multiply(vg_lite_matrix_t * matrix, vg_lite_matrix_t * mult)
 
 vg_lite_error_t vg_lite_translate(vg_lite_float_t x, vg_lite_float_t y, vg_lite_matrix_t * matrix)
 {
-    /* Set translation matrix. */
-    vg_lite_matrix_t t = { { {1.0f, 0.0f, x},
-            {0.0f, 1.0f, y},
-            {0.0f, 0.0f, 1.0f},
-        },
-        0.0f, 0.0f, 0.0f
-    };
+    int row;
 
-    /* Multiply with current matrix. */
-    multiply(matrix, &t);
+    /* Multiply with the translation matrix, only the last column changes. */
+    for (row = 0; row < 3; row++) {
+        matrix->m[row][2] += matrix->m[row][0] * x + matrix->m[row][1] * y;
+    }
 
     return VG_LITE_SUCCESS;
 }
 
 vg_lite_error_t vg_lite_scale(vg_lite_float_t scale_x, vg_lite_float_t scale_y, vg_lite_matrix_t * matrix)
 {
-    /* Set scale matrix. */
-    vg_lite_matrix_t s = { { {scale_x, 0.0f, 0.0f},
-            {0.0f, scale_y, 0.0f},
-            {0.0f, 0.0f, 1.0f},
-        },
-        0.0f, 0.0f, 0.0f
-    };
+    int row;
 
-    /* Multiply with current matrix. */
-    multiply(matrix, &s);
+    /* Multiply with the scale matrix, the first two columns are scaled. */
+    for (row = 0; row < 3; row++) {
+        matrix->m[row][0] *= scale_x;
+        matrix->m[row][1] *= scale_y;
+    }
 
 #if VG_SW_BLIT_PRECISION_OPT
     matrix->scaleX = matrix->scaleX * scale_x;
@@ -114,25 +120,54 @@ vg_lite_error_t vg_lite_scale(vg_lite_float_t scale_x, vg_lite_float_t scale_y,
     return VG_LITE_SUCCESS;
 }
 
+static void sin_cos(vg_lite_float_t degrees, vg_lite_float_t * sin_angle, vg_lite_float_t * cos_angle)
+{
+    vg_lite_float_t angle = fmodf(degrees, 360.0f);
+
+    if (angle < 0.0f)
+        angle += 360.0f;
+
+    /* Quarter turns are exact, sinf/cosf would leave a residue in the zero entries. */
+    if (angle == 0.0f) {
+        *sin_angle = 0.0f;
+        *cos_angle = 1.0f;
+    }
+    else if (angle == 90.0f) {
+        *sin_angle = 1.0f;
+        *cos_angle = 0.0f;
+    }
+    else if (angle == 180.0f) {
+        *sin_angle = 0.0f;
+        *cos_angle = -1.0f;
+    }
+    else if (angle == 270.0f) {
+        *sin_angle = -1.0f;
+        *cos_angle = 0.0f;
+    }
+    else {
+        /* Convert degrees into radians. */
+        angle = (angle / 180.0f) * 3.141592654f;
+        *sin_angle = sinf(angle);
+        *cos_angle = cosf(angle);
+    }
+}
+
 vg_lite_error_t vg_lite_rotate(vg_lite_float_t degrees, vg_lite_matrix_t * matrix)
 {
-    /* Convert degrees into radians. */
-    vg_lite_float_t angle = (degrees / 180.0f) * 3.141592654f;
+    vg_lite_float_t cos_angle, sin_angle;
+    int row;
 
-    /* Compuet cosine and sine values. */
-    vg_lite_float_t cos_angle = cosf(angle);
-    vg_lite_float_t sin_angle = sinf(angle);
-    
-    /* Set rotation matrix. */
-    vg_lite_matrix_t r = { { {cos_angle, -sin_angle, 0.0f},
-            {sin_angle, cos_angle, 0.0f},
-            {0.0f, 0.0f, 1.0f},
-        },
-        0.0f, 0.0f, 0.0f
-    };
+    /* Compute cosine and sine values. */
+    sin_cos(degrees, &sin_angle, &cos_angle);
 
-    /* Multiply with current matrix. */
-    multiply(matrix, &r);
+    /* Multiply with the rotation matrix, the first two columns are mixed. */
+    for (row = 0; row < 3; row++) {
+        vg_lite_float_t m0 = matrix->m[row][0];
+        vg_lite_float_t m1 = matrix->m[row][1];
+
+        matrix->m[row][0] = m0 * cos_angle + m1 * sin_angle;
+        matrix->m[row][1] = m1 * cos_angle - m0 * sin_angle;
+    }
 
 #if VG_SW_BLIT_PRECISION_OPT
     matrix->angle = matrix->angle + degrees;
@@ -144,3 +179,283 @@ vg_lite_error_t vg_lite_rotate(vg_lite_float_t degrees, vg_lite_matrix_t * matri
 
     return VG_LITE_SUCCESS;
 }
+
+vg_lite_error_t vg_lite_matrix_inverse(vg_lite_matrix_t * result, const vg_lite_matrix_t * matrix)
+{
+    vg_lite_float_t det00, det01, det02, d;
+
+    if (result == NULL)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    /* A NULL matrix is the identity. */
+    if (matrix == NULL)
+        return vg_lite_identity(result);
+
+    if (IS_AFFINE(matrix)) {
+        /* Invert the 2x2 linear part and move the translation through it. */
+        d = (matrix->m[0][0] * matrix->m[1][1]) - (matrix->m[0][1] * matrix->m[1][0]);
+        if (d == 0.0f)
+            return VG_LITE_INVALID_ARGUMENT;
+
+        d = 1.0f / d;
+
+        result->m[0][0] = d * matrix->m[1][1];
+        result->m[0][1] = -d * matrix->m[0][1];
+        result->m[1][0] = -d * matrix->m[1][0];
+        result->m[1][1] = d * matrix->m[0][0];
+        result->m[0][2] = -(result->m[0][0] * matrix->m[0][2] + result->m[0][1] * matrix->m[1][2]);
+        result->m[1][2] = -(result->m[1][0] * matrix->m[0][2] + result->m[1][1] * matrix->m[1][2]);
+        result->m[2][0] = 0.0f;
+        result->m[2][1] = 0.0f;
+        result->m[2][2] = 1.0f;
+    }
+    else {
+        det00 = (matrix->m[1][1] * matrix->m[2][2]) - (matrix->m[2][1] * matrix->m[1][2]);
+        det01 = (matrix->m[2][0] * matrix->m[1][2]) - (matrix->m[1][0] * matrix->m[2][2]);
+        det02 = (matrix->m[1][0] * matrix->m[2][1]) - (matrix->m[2][0] * matrix->m[1][1]);
+
+        /* Compute determinant. */
+        d = (matrix->m[0][0] * det00) + (matrix->m[0][1] * det01) + (matrix->m[0][2] * det02);
+        if (d == 0.0f)
+            return VG_LITE_INVALID_ARGUMENT;
+
+        d = 1.0f / d;
+
+        result->m[0][0] = d * det00;
+        result->m[0][1] = d * ((matrix->m[2][1] * matrix->m[0][2]) - (matrix->m[0][1] * matrix->m[2][2]));
+        result->m[0][2] = d * ((matrix->m[0][1] * matrix->m[1][2]) - (matrix->m[1][1] * matrix->m[0][2]));
+        result->m[1][0] = d * det01;
+        result->m[1][1] = d * ((matrix->m[0][0] * matrix->m[2][2]) - (matrix->m[2][0] * matrix->m[0][2]));
+        result->m[1][2] = d * ((matrix->m[1][0] * matrix->m[0][2]) - (matrix->m[0][0] * matrix->m[1][2]));
+        result->m[2][0] = d * det02;
+        result->m[2][1] = d * ((matrix->m[2][0] * matrix->m[0][1]) - (matrix->m[0][0] * matrix->m[2][1]));
+        result->m[2][2] = d * ((matrix->m[0][0] * matrix->m[1][1]) - (matrix->m[1][0] * matrix->m[0][1]));
+    }
+
+#if VG_SW_BLIT_PRECISION_OPT
+    result->scaleX = matrix->scaleX != 0.0f ? 1.0f / matrix->scaleX : 1.0f;
+    result->scaleY = matrix->scaleY != 0.0f ? 1.0f / matrix->scaleY : 1.0f;
+    result->angle = matrix->angle > 0.0f ? 360.0f - matrix->angle : 0.0f;
+#endif /* VG_SW_BLIT_PRECISION_OPT */
+
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_matrix_transform_points(const vg_lite_matrix_t * matrix,
+                                                const vg_lite_float_t * src,
+                                                vg_lite_float_t * dst,
+                                                vg_lite_uint32_t count)
+{
+    vg_lite_uint32_t i = 0;
+
+    if (matrix == NULL || (count && (src == NULL || dst == NULL)))
+        return VG_LITE_INVALID_ARGUMENT;
+
+    if (!IS_AFFINE(matrix)) {
+        for (; i < count; i++) {
+            vg_lite_float_t x = src[i * 2];
+            vg_lite_float_t y = src[i * 2 + 1];
+            vg_lite_float_t w = x * matrix->m[2][0] + y * matrix->m[2][1] + matrix->m[2][2];
+
+            /* Points on the horizon have no projection, they are left unscaled. */
+            w = w != 0.0f ? 1.0f / w : 1.0f;
+            dst[i * 2] = (x * matrix->m[0][0] + y * matrix->m[0][1] + matrix->m[0][2]) * w;
+            dst[i * 2 + 1] = (x * matrix->m[1][0] + y * matrix->m[1][1] + matrix->m[1][2]) * w;
+        }
+
+        return VG_LITE_SUCCESS;
+    }
+
+#if defined(VG_MATRIX_NEON)
+    {
+        /* Four points per iteration, split into x and y lanes by the structure load. */
+        float32x4_t m00 = vdupq_n_f32(matrix->m[0][0]), m01 = vdupq_n_f32(matrix->m[0][1]);
+        float32x4_t m02 = vdupq_n_f32(matrix->m[0][2]), m10 = vdupq_n_f32(matrix->m[1][0]);
+        float32x4_t m11 = vdupq_n_f32(matrix->m[1][1]), m12 = vdupq_n_f32(matrix->m[1][2]);
+
+        for (; i + 4 <= count; i += 4) {
+            float32x4x2_t p = vld2q_f32(src + i * 2);
+            float32x4x2_t r;
+
+            r.val[0] = vmlaq_f32(vmlaq_f32(m02, p.val[0], m00), p.val[1], m01);
+            r.val[1] = vmlaq_f32(vmlaq_f32(m12, p.val[0], m10), p.val[1], m11);
+            vst2q_f32(dst + i * 2, r);
+        }
+    }
+#elif defined(VG_MATRIX_SSE)
+    {
+        /* Two points per iteration, the lanes hold x0, y0, x1, y1. */
+        __m128 mx = _mm_setr_ps(matrix->m[0][0], matrix->m[1][0], matrix->m[0][0], matrix->m[1][0]);
+        __m128 my = _mm_setr_ps(matrix->m[0][1], matrix->m[1][1], matrix->m[0][1], matrix->m[1][1]);
+        __m128 mt = _mm_setr_ps(matrix->m[0][2], matrix->m[1][2], matrix->m[0][2], matrix->m[1][2]);
+
+        for (; i + 2 <= count; i += 2) {
+            __m128 p = _mm_loadu_ps(src + i * 2);
+            __m128 px = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 py = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+
+            _mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, mx), _mm_mul_ps(py, my)), mt));
+        }
+    }
+#endif
+
+    /* Remaining points. */
+    for (; i < count; i++) {
+        vg_lite_float_t x = src[i * 2];
+        vg_lite_float_t y = src[i * 2 + 1];
+
+        dst[i * 2] = x * matrix->m[0][0] + y * matrix->m[0][1] + matrix->m[0][2];
+        dst[i * 2 + 1] = x * matrix->m[1][0] + y * matrix->m[1][1] + matrix->m[1][2];
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_matrix_transform_bbox(const vg_lite_matrix_t * matrix,
+                                              const vg_lite_float_t * src,
+                                              vg_lite_float_t * dst,
+                                              vg_lite_uint32_t count)
+{
+    vg_lite_uint32_t i;
+
+    if (matrix == NULL || (count && (src == NULL || dst == NULL)))
+        return VG_LITE_INVALID_ARGUMENT;
+
+    for (i = 0; i < count; i++, src += 4, dst += 4) {
+        /* An unbounded box stays unbounded, FLT_MAX would turn into infinities and NaNs below. */
+        if (src[0] <= -FLT_MAX || src[1] <= -FLT_MAX || src[2] >= FLT_MAX || src[3] >= FLT_MAX) {
+            dst[0] = -FLT_MAX;
+            dst[1] = -FLT_MAX;
+            dst[2] = FLT_MAX;
+            dst[3] = FLT_MAX;
+            continue;
+        }
+
+        if (IS_AFFINE(matrix)) {
+            /* The center is transformed, the half extents grow by the absolute linear part. */
+            vg_lite_float_t cx = src[0] * 0.5f + src[2] * 0.5f;
+            vg_lite_float_t cy = src[1] * 0.5f + src[3] * 0.5f;
+            vg_lite_float_t hx = src[2] * 0.5f - src[0] * 0.5f;
+            vg_lite_float_t hy = src[3] * 0.5f - src[1] * 0.5f;
+            vg_lite_float_t ex = fabsf(matrix->m[0][0]) * hx + fabsf(matrix->m[0][1]) * hy;
+            vg_lite_float_t ey = fabsf(matrix->m[1][0]) * hx + fabsf(matrix->m[1][1]) * hy;
+            vg_lite_float_t tx = cx * matrix->m[0][0] + cy * matrix->m[0][1] + matrix->m[0][2];
+            vg_lite_float_t ty = cx * matrix->m[1][0] + cy * matrix->m[1][1] + matrix->m[1][2];
+
+            dst[0] = tx - ex;
+            dst[1] = ty - ey;
+            dst[2] = tx + ex;
+            dst[3] = ty + ey;
+        }
+        else {
+            vg_lite_float_t corners[8];
+            int j;
+
+            corners[0] = src[0]; corners[1] = src[1];
+            corners[2] = src[2]; corners[3] = src[1];
+            corners[4] = src[2]; corners[5] = src[3];
+            corners[6] = src[0]; corners[7] = src[3];
+
+            /* A corner behind the horizon projects to infinity, the box is unbounded. */
+            for (j = 0; j < 4; j++) {
+                if (corners[j * 2] * matrix->m[2][0] + corners[j * 2 + 1] * matrix->m[2][1] + matrix->m[2][2] <= 0.0f)
+                    break;
+            }
+
+            if (j < 4) {
+                dst[0] = -FLT_MAX;
+                dst[1] = -FLT_MAX;
+                dst[2] = FLT_MAX;
+                dst[3] = FLT_MAX;
+                continue;
+            }
+
+            vg_lite_matrix_transform_points(matrix, corners, corners, 4);
+
+            dst[0] = dst[2] = corners[0];
+            dst[1] = dst[3] = corners[1];
+            for (j = 1; j < 4; j++) {
+                dst[0] = corners[j * 2] < dst[0] ? corners[j * 2] : dst[0];
+                dst[2] = corners[j * 2] > dst[2] ? corners[j * 2] : dst[2];
+                dst[1] = corners[j * 2 + 1] < dst[1] ? corners[j * 2 + 1] : dst[1];
+                dst[3] = corners[j * 2 + 1] > dst[3] ? corners[j * 2 + 1] : dst[3];
+            }
+        }
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+static int square_to_quad(vg_lite_point4_t quad, vg_lite_matrix_t * matrix)
+{
+    /* Map the unit square corners (0,0), (1,0), (1,1), (0,1) to the quad, see Heckbert's
+    ** "Fundamentals of Texture Mapping and Image Warping". */
+    vg_lite_float_t x0 = (vg_lite_float_t)quad[0].x, y0 = (vg_lite_float_t)quad[0].y;
+    vg_lite_float_t x1 = (vg_lite_float_t)quad[1].x, y1 = (vg_lite_float_t)quad[1].y;
+    vg_lite_float_t x2 = (vg_lite_float_t)quad[2].x, y2 = (vg_lite_float_t)quad[2].y;
+    vg_lite_float_t x3 = (vg_lite_float_t)quad[3].x, y3 = (vg_lite_float_t)quad[3].y;
+    vg_lite_float_t sx = x0 - x1 + x2 - x3;
+    vg_lite_float_t sy = y0 - y1 + y2 - y3;
+    vg_lite_float_t g = 0.0f, h = 0.0f;
+
+    if (sx != 0.0f || sy != 0.0f) {
+        /* Not a parallelogram, solve for the projective terms. */
+        vg_lite_float_t dx1 = x1 - x2, dx2 = x3 - x2;
+        vg_lite_float_t dy1 = y1 - y2, dy2 = y3 - y2;
+        vg_lite_float_t det = dx1 * dy2 - dx2 * dy1;
+
+        if (det == 0.0f)
+            return 0;
+
+        g = (sx * dy2 - dx2 * sy) / det;
+        h = (dx1 * sy - sx * dy1) / det;
+    }
+
+    matrix->m[0][0] = x1 - x0 + g * x1;
+    matrix->m[0][1] = x3 - x0 + h * x3;
+    matrix->m[0][2] = x0;
+    matrix->m[1][0] = y1 - y0 + g * y1;
+    matrix->m[1][1] = y3 - y0 + h * y3;
+    matrix->m[1][2] = y0;
+    matrix->m[2][0] = g;
+    matrix->m[2][1] = h;
+    matrix->m[2][2] = 1.0f;
+
+    return 1;
+}
+
+vg_lite_error_t vg_lite_get_transform_matrix(vg_lite_point4_t src, vg_lite_point4_t dst, vg_lite_matrix_t * mat)
+{
+    vg_lite_matrix_t src_to_square, square_to_src, square_to_dst;
+    int row, column;
+
+    if (mat == NULL)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    /* dst = square_to_dst * inverse(square_to_src) * src */
+    if (!square_to_quad(src, &square_to_src) || vg_lite_matrix_inverse(&src_to_square, &square_to_src) != VG_LITE_SUCCESS)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    if (!square_to_quad(dst, &square_to_dst))
+        return VG_LITE_INVALID_ARGUMENT;
+
+    multiply(&square_to_dst, &src_to_square);
+
+    /* Normalize so that the last entry is 1. */
+    if (square_to_dst.m[2][2] == 0.0f)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    for (row = 0; row < 3; row++) {
+        for (column = 0; column < 3; column++) {
+            mat->m[row][column] = square_to_dst.m[row][column] / square_to_dst.m[2][2];
+        }
+    }
+
+#if VG_SW_BLIT_PRECISION_OPT
+    mat->scaleX = 1.0f;
+    mat->scaleY = 1.0f;
+    mat->angle   = 0.0f;
+#endif /* VG_SW_BLIT_PRECISION_OPT */
+
+    return VG_LITE_SUCCESS;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file vg_lite_matrix.h
+ *
+ * Matrix routines of vg_lite_matrix.c used by the simulator, beyond the vg_lite.h API.
+ */
+
+#ifndef VG_LITE_MATRIX_H
+#define VG_LITE_MATRIX_H
+
+#include "vg_lite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Invert a matrix. A NULL (matrix) is the identity. */
+vg_lite_error_t vg_lite_matrix_inverse(vg_lite_matrix_t * result, const vg_lite_matrix_t * matrix);
+
+/* Transform (count) points stored as x, y pairs. (src) and (dst) may be the same array. */
+vg_lite_error_t vg_lite_matrix_transform_points(const vg_lite_matrix_t * matrix,
+                                                const vg_lite_float_t * src,
+                                                vg_lite_float_t * dst,
+                                                vg_lite_uint32_t count);
+
+/**
+ * Transform (count) boxes stored as x_min, y_min, x_max, y_max into the boxes bounding the results.
+ * A box with an edge at +/-FLT_MAX is unbounded and stays the unbounded box.
+ */
+vg_lite_error_t vg_lite_matrix_transform_bbox(const vg_lite_matrix_t * matrix,
+                                              const vg_lite_float_t * src,
+                                              vg_lite_float_t * dst,
+                                              vg_lite_uint32_t count);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VG_LITE_MATRIX_H */
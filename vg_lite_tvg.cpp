@@ -10,18 +10,41 @@
 #if LV_USE_DRAW_VG_LITE && LV_USE_VG_LITE_THORVG
 
 #include "vg_lite.h"
+#include "vg_lite_matrix.h"
+#include "vg_lite_tvg.h"
 #include "thorvg.h"
+#include <algorithm>
 #include <float.h>
+#include <list>
+#include <map>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #if LV_VG_LITE_THORVG_YUV_SUPPORT
     #include <libyuv/convert_argb.h>
 #endif
 
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if LV_VG_LITE_THORVG_DMABUF_SUPPORT
+    #include <linux/dma-buf.h>
+    #include <sys/ioctl.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
 /*********************
  *      DEFINES
  *********************/
@@ -72,6 +95,14 @@
 #define LERP(v1, v2, w) ((v1) * (w) + (v2) * (1.0f - (w)))
 #define CLAMP(x, min, max) (((x) < (min)) ? (min) : ((x) > (max)) ? (max) : (x))
 #define COLOR_FROM_RAMP(ColorRamp) (((vg_lite_float_t*)ColorRamp) + 1)
+#define MATH_SQRT2 1.41421356f
+
+/* granularity of the level-of-detail cache, a path is re-flattened every quarter octave of scale */
+#define LOD_BUCKETS_PER_OCTAVE 4
+
+/* segments of a curve flattened in one go, longer curves are split in halves first */
+#define FLATTEN_SEGMENTS_MAX 256
+#define FLATTEN_DEPTH_MAX 8
 
 #define VG_LITE_RETURN_ERROR(func)         \
     if ((error = func) != VG_LITE_SUCCESS) \
@@ -144,18 +175,289 @@ typedef struct {
     vg_lite_float_t y;
 } vg_lite_fpoint_t;
 
+typedef struct {
+    vg_lite_float_t x_min;
+    vg_lite_float_t y_min;
+    vg_lite_float_t x_max;
+    vg_lite_float_t y_max;
+} vg_lite_fbox_t;
+
 #pragma pack()
 
+typedef struct {
+    int32_t x_min;
+    int32_t y_min;
+    int32_t x_max;
+    int32_t y_max;
+} vg_lite_ibox_t;
+
+/* from the cheapest to the most general, the first four are axis-aligned */
+typedef enum {
+    MATRIX_CLASS_IDENTITY,
+    MATRIX_CLASS_TRANSLATE,
+    MATRIX_CLASS_SCALE,         /* scale and translate */
+    MATRIX_CLASS_AXIS_ALIGNED,  /* also rotated by a multiple of 90 degrees or flipped */
+    MATRIX_CLASS_AFFINE,
+    MATRIX_CLASS_PERSPECTIVE,
+} vg_lite_matrix_class_t;
+
+typedef struct {
+    vg_lite_float_t tolerance;  /* curve flattening tolerance in device pixels */
+    vg_lite_uint32_t samples;   /* sub-scanlines per pixel row, must be a power of 2 */
+} vg_lite_quality_tier_t;
+
+typedef struct {
+    vg_lite_uint32_t begin;
+    vg_lite_uint32_t count;
+    bool closed;
+} vg_lite_contour_t;
+
+typedef struct {
+    std::vector<vg_lite_fpoint_t> points;
+    std::vector<vg_lite_contour_t> contours;
+    vg_lite_fbox_t extents;         /* hull of the points */
+    vg_lite_fbox_t path_extents;    /* hull of the source points, control points included */
+} vg_lite_polygon_t;
+
+typedef struct {
+    const void * data;
+    vg_lite_uint32_t length;
+    vg_lite_format_t format;
+    vg_lite_quality_t quality;
+    bool is_fill;
+    int32_t scale_bucket;
+} vg_lite_lod_key_t;
+
+typedef struct {
+    vg_lite_lod_key_t key;
+    vg_lite_uint32_t hash;      /* of the path data it was made from */
+    vg_lite_polygon_t polygon;  /* simplified outline, in path space */
+    std::vector<PathCommand> cmds;
+    std::vector<Point> pts;
+} vg_lite_lod_t;
+
+struct vg_lite_lod_key_hash {
+    size_t operator()(const vg_lite_lod_key_t & key) const
+    {
+        /* the bucket tells the levels of a path apart */
+        return std::hash<const void *>()(key.data) ^ ((size_t)key.length * 31 + (size_t)key.scale_bucket);
+    }
+};
+
+struct vg_lite_lod_key_equal {
+    bool operator()(const vg_lite_lod_key_t & a, const vg_lite_lod_key_t & b) const
+    {
+        return a.data == b.data
+               && a.length == b.length
+               && a.format == b.format
+               && a.quality == b.quality
+               && a.is_fill == b.is_fill
+               && a.scale_bucket == b.scale_bucket;
+    }
+};
+
+typedef struct {
+    const void * memory;
+    vg_lite_uint32_t width;
+    vg_lite_uint32_t height;
+    int32_t stride;
+    vg_lite_buffer_format_t format;
+    vg_lite_image_mode_t image_mode;
+    vg_lite_color_t color;
+    vg_lite_uint32_t src_alpha;     /* global alpha mode and value the levels were made with */
+    vg_lite_color_key4_t color_keys;
+    vg_lite_uint32_t color_stage;   /* serial of the color stage, 0 without one */
+    vg_lite_uint32_t signature;     /* hash of all the source rows, catches the edits in place and reused memory */
+} vg_lite_mip_key_t;
+
+typedef struct {
+    vg_lite_uint32_t width;
+    vg_lite_uint32_t height;
+    std::vector<vg_lite_uint32_t> pixels;   /* premultiplied ARGB8888 */
+} vg_lite_mip_level_t;
+
+typedef struct {
+    vg_lite_mip_key_t key;
+    std::vector<vg_lite_mip_level_t> levels;    /* levels[i] is 2^(i+1) times smaller than the source */
+    size_t size;                                /* bytes of all the levels */
+} vg_lite_mip_t;
+
+typedef struct {
+    std::map<size_t, std::vector<void *>> free_blocks;  /* released blocks kept for reuse, by size class */
+    std::unordered_map<void *, size_t> used_blocks;     /* size class of the allocated blocks */
+    size_t live_size;                                   /* bytes of the allocated blocks */
+    size_t peak_size;                                   /* most bytes allocated at once */
+    size_t cached_size;                                 /* bytes of the released blocks */
+} vg_lite_pool_t;
+
+typedef struct {
+    size_t size;    /* bytes mapped from the fd, 0 for the user memory */
+    int fd;         /* duplicate of the imported fd, -1 for the user memory */
+    bool dmabuf;    /* the fd is a dma-buf, the CPU access is synchronized with its ioctls */
+    bool synced;    /* the CPU access to the dma-buf is started, until vg_lite_finish() */
+} vg_lite_mapping_t;
+
+typedef struct {
+    bool enabled;                   /* any of the gamma, the pixel matrix and the color transform is set */
+    bool mixes;                     /* the pixel matrix mixes the channels, it runs between 'pre' and 'post' */
+    uint8_t pre[4][256];            /* per channel tables, by byte of the ARGB8888 pixels */
+    uint8_t post[4][256];
+    vg_lite_float_t matrix[4][5];   /* by byte as well, on 0 ~ 255 values, the bias last */
+    vg_lite_uint32_t serial;        /* changes with the state, the mip levels are made with one */
+} vg_lite_color_stage_t;
+
+typedef struct {
+    vg_lite_float_t x;          /* x at y_top */
+    vg_lite_float_t y_top;
+    vg_lite_float_t y_bottom;
+    vg_lite_float_t slope;      /* dx / dy */
+    int32_t dir;
+} vg_lite_edge_t;
+
+typedef struct {
+    vg_lite_float_t x;
+    int32_t dir;
+} vg_lite_crossing_t;
+
+typedef struct {
+    std::vector<vg_lite_edge_t> edges;
+    std::vector<vg_lite_uint32_t> active;
+    std::vector<vg_lite_crossing_t> crossings;
+    std::vector<int32_t> cells;     /* coverage deltas of whole pixels */
+    std::vector<int32_t> partial;   /* coverage of the pixels crossed by a span end */
+    std::vector<uint8_t> coverage;
+    std::vector<uint8_t> row_coverage;
+    const uint8_t * mask;           /* A8 mask layer scaling the coverage, when enabled */
+    int32_t mask_stride;
+    int32_t mask_width;
+    int32_t mask_height;
+    std::vector<uint8_t> masked;    /* coverage of a span times the mask */
+    vg_lite_global_alpha_t src_alpha_mode;  /* global alpha of the image sources */
+    vg_lite_uint8_t src_alpha_value;
+    vg_lite_global_alpha_t dest_alpha_mode; /* global alpha of the target, as read by the blending */
+    vg_lite_uint8_t dest_alpha_value;
+} vg_lite_raster_t;
+
+typedef struct {
+    const vg_lite_uint32_t * image; /* premultiplied ARGB8888 */
+    int32_t stride;                 /* in pixels */
+    vg_lite_ibox_t box;             /* the texels that can be read */
+    vg_lite_filter_t filter;
+    vg_lite_pattern_mode_t mode;    /* how the texels outside of the box are read */
+    vg_lite_uint32_t border;        /* premultiplied color outside of the box for VG_LITE_PATTERN_COLOR */
+    vg_lite_uint32_t gaussian[3];   /* center, side and corner weights of the 3x3 kernel, they sum up to 256 */
+    vg_lite_matrix_t inverse;       /* target pixel to source texel */
+} vg_lite_sampler_t;
+
+typedef struct {
+    vg_lite_uint32_t color;         /* premultiplied ARGB8888 */
+    vg_lite_blend_t blend;
+    const vg_lite_uint32_t * ramp;  /* premultiplied ARGB8888 gradient, replaces the color when set */
+    int32_t ramp_last;
+    int64_t index_x;                /* ramp index of the pixel (x, y) in 16.16 fixed point: */
+    int64_t index_y;                /* x * index_x + y * index_y + index_origin */
+    int64_t index_origin;
+    const vg_lite_sampler_t * sampler;  /* image, replaces the color when set */
+    vg_lite_uint32_t * texels;      /* scratch for the sampled span, as wide as the target */
+    const vg_lite_sampler_t * sampler2; /* image composited over the first one, when set */
+    vg_lite_uint32_t * texels2;
+    uint8_t * layer;                /* A8 mask layer receiving the coverage times the alpha of the color, */
+    int32_t layer_stride;           /* instead of the target */
+} vg_lite_raster_paint_t;
+
+typedef struct {
+    vg_lite_ibox_t src_box;         /* the source texels drawn */
+    vg_lite_matrix_t warp;          /* source texel to target pixel */
+    vg_lite_matrix_t inverse;
+} vg_lite_blit_t;
+
+typedef struct {
+    vg_lite_float_t pos;        /* in texels */
+    vg_lite_uint32_t color;     /* packed in the byte order of the ramp image */
+} vg_lite_ramp_stop_t;
+
+typedef struct {
+    vg_lite_uint32_t hash;
+    vg_lite_uint32_t width;
+    std::vector<vg_lite_ramp_stop_t> stops;
+    std::vector<vg_lite_uint32_t> texels;
+} vg_lite_ramp_t;
+
+typedef struct {
+    const void * grad;
+    vg_lite_uint32_t signature;     /* hash of the stops and parameters the fill was made from */
+    std::unique_ptr<Fill> fill;     /* converted stops, duplicated for each draw */
+    vg_lite_matrix_t grad_matrix;   /* the matrices the fill transform was computed from */
+    vg_lite_matrix_t path_matrix;
+    bool matrix_valid;
+    std::vector<vg_lite_uint32_t> ramp; /* premultiplied ramp of a vg_lite_linear_gradient_t */
+} vg_lite_fill_cache_t;
+
+typedef Result(*fill_gen_cb_t)(std::unique_ptr<Fill> & fill, const void * grad);
+typedef vg_lite_uint32_t(*fill_sign_cb_t)(const void * grad);
+typedef Result(*fill_set_matrix_cb_t)(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix);
+
 class vg_lite_ctx
 {
     public:
         std::unique_ptr<SwCanvas> canvas;
         void * target_buffer;
         void * tvg_target_buffer;
+        vg_lite_uint32_t tvg_target_stride;
         vg_lite_uint32_t target_px_size;
         vg_lite_buffer_format_t target_format;
-        vg_lite_rectangle_t scissor_rect;
-        bool scissor_is_set;
+        std::vector<vg_lite_rectangle_t> scissor_rects;    /* clip of the commands, captured with each of them */
+        bool scissor_enabled;
+        bool scissor_clip_all;  /* the rects given were all empty, nothing is drawn */
+        vg_lite_buffer_t * masklayer;
+        bool mask_enabled;
+        std::vector<uint8_t> mask_coverage;             /* path rendered by vg_lite_render_masklayer() */
+        std::vector<vg_lite_uint32_t> composite_backup; /* target area under a thorvg paint composited afterwards */
+        std::vector<vg_lite_uint32_t> composite_source;
+        std::vector<uint8_t> composite_coverage;
+        vg_lite_color_key4_t color_keys;                /* of the decoded images, the disabled keys are cleared */
+        bool color_key_enabled;
+        vg_lite_gamma_conversion_t gamma_conversion;
+        vg_lite_float_t pixel_matrix[20];
+        vg_lite_pixel_channel_enable_t pixel_matrix_channels;
+        vg_lite_color_transform_t color_transform;
+        bool color_transform_enabled;
+        vg_lite_color_stage_t color_stage;          /* the three above compiled for the image decode */
+        vg_lite_orientation_t mirror;
+        vg_lite_uint32_t culled_count;
+        bool target_dirty;
+
+        /* target area the pushed paints land in, empty when none is pending */
+        vg_lite_ibox_t pending_area;
+        vg_lite_uint32_t gaussian_weights[3];
+
+        /* scratch of the built-in rasterizer, kept to reuse the allocations */
+        vg_lite_polygon_t polygon;
+        vg_lite_raster_t raster;
+
+        /* simplified paths, most recently used first */
+        std::list<vg_lite_lod_t> lod_cache;
+        std::unordered_map<vg_lite_lod_key_t, std::list<vg_lite_lod_t>::iterator, vg_lite_lod_key_hash,
+            vg_lite_lod_key_equal> lod_index;
+
+        /* gradient ramps shared by the gradients with the same stops, most recently used first */
+        std::list<vg_lite_ramp_t> ramp_cache;
+
+        /* ramp images allocated by the gradient updates, memory to gradient */
+        std::unordered_map<const void *, const void *> ramp_images;
+
+        /* mipmaps of the down-scaled blit sources, most recently used first */
+        std::list<vg_lite_mip_t> mip_cache;
+        size_t mip_cache_size;
+
+        /* thorvg fills of the updated gradients, most recently used first */
+        std::list<vg_lite_fill_cache_t> fill_cache;
+
+        /* memory of the buffers of vg_lite_allocate() */
+        vg_lite_pool_t pool;
+
+        /* buffers of vg_lite_map(), by memory */
+        std::unordered_map<void *, vg_lite_mapping_t> mappings;
 
         static vg_lite_ctx * g_context;
 
@@ -163,10 +465,29 @@ class vg_lite_ctx
         vg_lite_ctx()
             : target_buffer { nullptr }
             , tvg_target_buffer { nullptr }
+            , tvg_target_stride { 0 }
             , target_px_size { 0 }
             , target_format { VG_LITE_BGRA8888 }
-            , scissor_rect { 0, 0, 0, 0 }
-            , scissor_is_set { false }
+            , scissor_enabled { false }
+            , scissor_clip_all { false }
+            , masklayer { nullptr }
+            , mask_enabled { false }
+            , color_keys {}
+            , color_key_enabled { false }
+            , gamma_conversion { VG_LITE_GAMMA_NO_CONVERSION }
+            , pixel_matrix { 0 }
+            , pixel_matrix_channels {}
+            , color_transform { 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f }
+            , color_transform_enabled { false }
+            , color_stage {}
+            , mirror { VG_LITE_ORIENTATION_TOP_BOTTOM }
+            , culled_count { 0 }
+            , target_dirty { false }
+            , pending_area { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN }
+            , gaussian_weights { 64, 32, 16 }
+            , raster {}
+            , mip_cache_size { 0 }
+            , pool {}
             , clut_2colors { 0 }
             , clut_4colors { 0 }
             , clut_16colors { 0 }
@@ -181,6 +502,28 @@ class vg_lite_ctx
             return src_buffer.data();
         }
 
+        /* a slot per source of vg_lite_blit2() */
+        vg_lite_uint32_t * get_sample_buffer(vg_lite_uint32_t w, vg_lite_uint32_t h, int slot)
+        {
+            sample_buffer[slot].resize(w * h);
+            return sample_buffer[slot].data();
+        }
+
+        /* moves the decoded image to a sample slot, the next decode does not overwrite it */
+        const vg_lite_uint32_t * take_image_buffer(int slot)
+        {
+            src_buffer.swap(sample_buffer[slot]);
+            return sample_buffer[slot].data();
+        }
+
+        vg_lite_uint32_t * get_sample_span(vg_lite_uint32_t w, int slot)
+        {
+            if(w > sample_span[slot].size()) {
+                sample_span[slot].resize(w);
+            }
+            return sample_span[slot].data();
+        }
+
         vg_lite_uint32_t * get_temp_target_buffer(vg_lite_uint32_t w, vg_lite_uint32_t h)
         {
             vg_lite_uint32_t px_size = w * h;
@@ -248,6 +591,8 @@ class vg_lite_ctx
         /*  */
         std::vector<vg_lite_uint32_t> src_buffer;
         std::vector<vg_lite_uint32_t> dest_buffer;
+        std::vector<vg_lite_uint32_t> sample_buffer[2];
+        std::vector<vg_lite_uint32_t> sample_span[2];
 
         vg_lite_uint32_t clut_2colors[2];
         vg_lite_uint32_t clut_4colors[4];
@@ -270,15 +615,24 @@ class vg_lite_converter
         {
         }
 
-        void convert(vg_lite_buffer_t * dest_buf, const vg_lite_buffer_t * src_buf, vg_lite_uint32_t color = 0)
+        /* a non-negative alpha replaces the one of each row while it is still in the cache */
+        void convert(vg_lite_buffer_t * dest_buf, const vg_lite_buffer_t * src_buf, vg_lite_uint32_t color = 0,
+                     int32_t alpha = -1)
         {
             LV_ASSERT(_converter_cb);
+            LV_ASSERT(alpha < 0 || sizeof(DEST_TYPE) == sizeof(vg_color32_t));
             uint8_t * dest = (uint8_t *)dest_buf->memory;
             const uint8_t * src = (const uint8_t *)src_buf->memory;
             vg_lite_uint32_t h = src_buf->height;
 
             while(h--) {
                 _converter_cb((DEST_TYPE *)dest, (const SRC_TYPE *)src, src_buf->width, color);
+                if(alpha >= 0) {
+                    vg_color32_t * px = (vg_color32_t *)dest;
+                    for(vg_lite_uint32_t x = 0; x < src_buf->width; x++) {
+                        px[x].alpha = (uint8_t)alpha;
+                    }
+                }
                 dest += dest_buf->stride;
                 src += src_buf->stride;
             }
@@ -296,17 +650,121 @@ typedef vg_lite_float_t FLOATVECTOR4[4];
 
 static vg_lite_error_t vg_lite_error_conv(Result result);
 static Matrix matrix_conv(const vg_lite_matrix_t * matrix);
+static vg_lite_matrix_class_t matrix_classify(const vg_lite_matrix_t * matrix);
+static bool matrix_is_axis_aligned(const vg_lite_matrix_t * matrix);
+static bool matrix_has_perspective(const vg_lite_matrix_t * matrix);
+static vg_lite_float_t matrix_get_scale(const vg_lite_matrix_t * matrix);
 static FillRule fill_rule_conv(vg_lite_fill_t fill);
 static BlendMethod blend_method_conv(vg_lite_blend_t blend);
+static bool blend_is_native(vg_lite_blend_t blend);
+static inline bool blend_is_source_over(vg_lite_blend_t blend);
+static void blend_span(const vg_lite_raster_t * raster, vg_lite_blend_t blend, vg_lite_uint32_t * dest,
+                       const vg_lite_uint32_t * src, const uint8_t * coverage, int32_t len);
 static StrokeCap stroke_cap_conv(vg_lite_cap_style_t cap);
 static StrokeJoin stroke_join_conv(vg_lite_join_style_t join);
 static FillSpread fill_spread_conv(vg_lite_gradient_spreadmode_t spread);
-static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t * path, vg_lite_matrix_t * matrix);
+static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t * path, vg_lite_matrix_t * matrix,
+                                vg_lite_fbox_t * bounds, vg_lite_fbox_t * extent);
 static Result shape_append_rect(std::unique_ptr<Shape> & shape, const vg_lite_buffer_t * target,
                                 const vg_lite_rectangle_t * rect);
 static Result canvas_set_target(vg_lite_ctx * ctx, vg_lite_buffer_t * target);
+static Result canvas_push(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, std::unique_ptr<Paint> paint,
+                          vg_lite_blend_t blend, const vg_lite_fbox_t * bounds = nullptr,
+                          const vg_lite_fbox_t * extent = nullptr, vg_lite_uint32_t alpha = 0xFF);
+static bool scissor_get_clip(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, vg_lite_ibox_t * clip);
+static Result canvas_push_composited(vg_lite_ctx * ctx, std::unique_ptr<Paint> paint, vg_lite_uint32_t alpha,
+                                     const vg_lite_ibox_t * clip, vg_lite_blend_t blend);
+static void mask_update(vg_lite_ctx * ctx);
+static void mask_blend_row(uint8_t * dest, const uint8_t * src, int32_t len, vg_lite_mask_operation_t operation);
+static vg_lite_error_t mask_render_path(vg_lite_ctx * ctx, vg_lite_buffer_t * masklayer,
+                                        vg_lite_mask_operation_t operation, const vg_lite_path_t * path,
+                                        vg_lite_fill_t fill_rule, vg_lite_color_t color,
+                                        const vg_lite_matrix_t * matrix);
+static bool path_clip_to_bbox(const vg_lite_path_t * path, const vg_lite_matrix_t * matrix,
+                              const vg_lite_polygon_t * polygon, vg_lite_ibox_t * clip);
+static bool draw_is_culled(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_fbox_t * box,
+                           const vg_lite_matrix_t * matrix);
+static bool path_is_culled(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                           const vg_lite_matrix_t * matrix);
 static Result picture_load(vg_lite_ctx * ctx, std::unique_ptr<Picture> & picture, const vg_lite_buffer_t * source,
                            vg_lite_color_t color = 0);
+static bool image_convert_row(vg_lite_ctx * ctx, const vg_lite_buffer_t * source, int32_t x, int32_t y,
+                              int32_t width, vg_lite_uint32_t * out);
+static bool image_write_row(const vg_lite_buffer_t * target, int32_t x, int32_t y, int32_t width,
+                            const vg_lite_uint32_t * row);
+static Result image_copy(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                         int32_t sx, int32_t sy, int32_t dx, int32_t dy, int32_t width, int32_t height);
+static void color_key_apply(const vg_lite_color_key_t * keys, vg_lite_uint32_t * pixels, vg_lite_uint32_t count);
+static void color_stage_update(vg_lite_ctx * ctx);
+static void color_stage_apply(const vg_lite_color_stage_t * stage, vg_lite_uint32_t * pixels, vg_lite_uint32_t count);
+static vg_lite_color_t color_transform_apply(const vg_lite_ctx * ctx, vg_lite_color_t color);
+static const vg_lite_uint32_t * picture_decode(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                               vg_lite_color_t color, bool global_alpha);
+static Result raster_blit(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                          const vg_lite_rectangle_t * rect, const vg_lite_matrix_t * matrix, vg_lite_blend_t blend,
+                          vg_lite_color_t color, vg_lite_filter_t filter);
+static Result raster_blit_transform(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                                    const vg_lite_rectangle_t * rect, const vg_lite_matrix_t * matrix,
+                                    vg_lite_blend_t blend, vg_lite_color_t color, vg_lite_filter_t filter);
+static Result raster_blit2(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source0,
+                           const vg_lite_buffer_t * source1, const vg_lite_matrix_t * matrix0,
+                           const vg_lite_matrix_t * matrix1, vg_lite_blend_t blend, vg_lite_filter_t filter);
+static bool blit_prepare(vg_lite_blit_t * blit, const vg_lite_buffer_t * source, const vg_lite_rectangle_t * rect,
+                         const vg_lite_matrix_t * matrix);
+static bool blit_get_offset(const vg_lite_blit_t * blit, vg_lite_filter_t filter, vg_lite_ibox_t * area,
+                            bool * flipped);
+static vg_lite_matrix_t * mirror_apply(const vg_lite_ctx * ctx, vg_lite_matrix_t * matrix, vg_lite_float_t height,
+                                       vg_lite_matrix_t * mirrored);
+static void blit_blend_row(const vg_lite_raster_t * raster, vg_lite_uint32_t * dest, const vg_lite_uint32_t * src,
+                           int32_t x_min, int32_t x_max, vg_lite_blend_t blend);
+static bool blit_add_outline(vg_lite_polygon_t * polygon, const vg_lite_blit_t * blit, const vg_lite_ibox_t * clip);
+static void blit_init_sampler(vg_lite_ctx * ctx, vg_lite_sampler_t * sampler, const vg_lite_blit_t * blit,
+                              const vg_lite_buffer_t * source, vg_lite_color_t color, vg_lite_filter_t filter,
+                              int slot);
+static Result raster_draw_pattern(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                                  vg_lite_fill_t fill_rule, const vg_lite_matrix_t * path_matrix,
+                                  const vg_lite_buffer_t * source, const vg_lite_matrix_t * pattern_matrix,
+                                  vg_lite_blend_t blend, vg_lite_pattern_mode_t pattern_mode,
+                                  vg_lite_color_t pattern_color, vg_lite_color_t color, vg_lite_filter_t filter);
+static const vg_lite_uint32_t * sampler_prepare_image(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                                      vg_lite_color_t color, const vg_lite_ibox_t * box, int slot);
+static void sampler_init(vg_lite_ctx * ctx, vg_lite_sampler_t * sampler, const vg_lite_uint32_t * image,
+                         int32_t stride, const vg_lite_ibox_t * box, vg_lite_filter_t filter);
+static void sampler_fetch_span(const vg_lite_sampler_t * sampler, int32_t x, int32_t y, int32_t len,
+                               vg_lite_uint32_t * out);
+static vg_lite_uint32_t mip_get_level(const vg_lite_buffer_t * source, const vg_lite_matrix_t * matrix,
+                                      vg_lite_filter_t filter);
+static const vg_lite_mip_level_t * mip_cache_get(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                                 vg_lite_color_t color, vg_lite_uint32_t level, int slot);
+static void mip_cache_trim(vg_lite_ctx * ctx);
+static void mip_cache_drop(vg_lite_ctx * ctx, const vg_lite_buffer_t * source);
+static size_t pool_class_size(size_t size);
+static vg_lite_error_t pool_alloc(vg_lite_ctx * ctx, size_t size, void ** memory);
+static bool pool_free(vg_lite_ctx * ctx, void * memory);
+static void pool_trim(vg_lite_ctx * ctx, size_t cached_max);
+static bool mapping_sync(const vg_lite_mapping_t * mapping, bool start);
+static void mapping_begin(vg_lite_ctx * ctx, const vg_lite_buffer_t * buffer);
+static void mapping_end(vg_lite_ctx * ctx);
+static Result canvas_flush(vg_lite_ctx * ctx);
+static Result canvas_flush_area(vg_lite_ctx * ctx, const vg_lite_ibox_t * clip, const vg_lite_fbox_t * extent,
+                                const vg_lite_buffer_t * source = nullptr);
+static bool path_flatten(vg_lite_polygon_t * polygon, const vg_lite_path_t * path, vg_lite_float_t tolerance);
+static const vg_lite_lod_t * path_get_lod(vg_lite_ctx * ctx, const vg_lite_path_t * path,
+                                          const vg_lite_matrix_t * matrix);
+static void path_drop_lod(vg_lite_ctx * ctx, const vg_lite_path_t * path);
+static void raster_output_span(vg_lite_raster_t * raster, const vg_lite_raster_paint_t * paint,
+                               vg_lite_uint32_t * dest, const uint8_t * coverage, int32_t len, int32_t x, int32_t y);
+static void raster_fill_polygon(vg_lite_raster_t * raster, const vg_lite_polygon_t * polygon, vg_lite_fill_t fill_rule,
+                                vg_lite_uint32_t samples, const vg_lite_ibox_t * clip, const vg_lite_raster_paint_t * paint,
+                                vg_lite_uint32_t * dest, vg_lite_uint32_t stride);
+static Result raster_draw_path(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                               vg_lite_fill_t fill_rule, const vg_lite_matrix_t * matrix,
+                               const vg_lite_raster_paint_t * paint);
+static Result raster_draw_rrect(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                                const vg_lite_matrix_t * matrix, const vg_lite_raster_paint_t * paint);
+static Result raster_draw_grad(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                               vg_lite_fill_t fill_rule, const vg_lite_matrix_t * matrix,
+                               const vg_lite_linear_gradient_t * grad, vg_lite_blend_t blend);
 
 static inline bool math_zero(float a)
 {
@@ -318,6 +776,93 @@ static inline bool math_equal(float a, float b)
     return math_zero(a - b);
 }
 
+static inline vg_lite_float_t point_length(vg_lite_float_t x, vg_lite_float_t y)
+{
+    return sqrtf(x * x + y * y);
+}
+
+static inline void fbox_add_point(vg_lite_fbox_t * box, float x, float y)
+{
+    box->x_min = MIN(box->x_min, x);
+    box->y_min = MIN(box->y_min, y);
+    box->x_max = MAX(box->x_max, x);
+    box->y_max = MAX(box->y_max, y);
+}
+
+static inline bool fbox_is_empty(const vg_lite_fbox_t * box)
+{
+    return box->x_min > box->x_max || box->y_min > box->y_max;
+}
+
+static inline bool fbox_contains(const vg_lite_fbox_t * box, const vg_lite_fbox_t * other)
+{
+    return other->x_min >= box->x_min && other->y_min >= box->y_min
+           && other->x_max <= box->x_max && other->y_max <= box->y_max;
+}
+
+static inline bool fbox_intersects(const vg_lite_fbox_t * box, const vg_lite_fbox_t * other)
+{
+    return other->x_min < box->x_max && other->x_max > box->x_min
+           && other->y_min < box->y_max && other->y_max > box->y_min;
+}
+
+static inline uint8_t mul_div255(vg_lite_uint32_t a, vg_lite_uint32_t b)
+{
+    /* a * b / 255, rounded */
+    vg_lite_uint32_t x = a * b + 128;
+    return (uint8_t)((x + (x >> 8)) >> 8);
+}
+
+static inline vg_lite_uint32_t pixel_scale(vg_lite_uint32_t px, vg_lite_uint32_t a)
+{
+    /* scale all four channels at once, 'a' is in range 0 ~ 255 */
+    a += a >> 7;
+    return ((((px & 0x00ff00ff) * a) >> 8) & 0x00ff00ff) | ((((px >> 8) & 0x00ff00ff) * a) & 0xff00ff00);
+}
+
+static inline vg_lite_uint32_t pixel_unscale(vg_lite_uint32_t px, vg_lite_uint32_t a)
+{
+    /* the inverse of pixel_scale(), the channels are rounded and clamped to 255 */
+    if(a == 0 || a == 0xFF) {
+        return px;
+    }
+
+    vg_lite_uint32_t out = 0;
+    for(int shift = 0; shift < 32; shift += 8) {
+        vg_lite_uint32_t c = (((px >> shift) & 0xFF) * 255 + a / 2) / a;
+        out |= (c > 0xFF ? 0xFF : c) << shift;
+    }
+
+    return out;
+}
+
+static inline vg_lite_uint32_t pixel_premultiply(vg_lite_uint32_t px)
+{
+    vg_lite_uint32_t alpha = A(px);
+    return alpha == 0xFF ? px : (pixel_scale(px, alpha) & 0x00ffffff) | (alpha << 24);
+}
+
+static inline vg_lite_uint32_t pixel_global_alpha(vg_lite_uint32_t px, vg_lite_global_alpha_t mode,
+                                                  vg_lite_uint8_t value)
+{
+    /* only the alpha channel is replaced or scaled, like the hardware does */
+    switch(mode) {
+        case VG_LITE_GLOBAL:
+            return (px & 0x00ffffff) | (vg_lite_uint32_t)value << 24;
+        case VG_LITE_SCALED:
+            return (px & 0x00ffffff) | (vg_lite_uint32_t)mul_div255(A(px), value) << 24;
+        default:
+            return px;
+    }
+}
+
+static inline vg_lite_uint32_t color_premultiply(vg_lite_color_t color)
+{
+    /* vg_lite_color_t is ABGR, the canvas is premultiplied ARGB */
+    vg_lite_uint32_t argb = ARGB(0xFFU, B(color), G(color), R(color));
+    return (pixel_scale(argb, A(color)) & 0x00ffffff) | (A(color) << 24);
+}
+
 static void ClampColor(FLOATVECTOR4 Source, FLOATVECTOR4 Target, uint8_t Premultiplied);
 static uint8_t PackColorComponent(vg_lite_float_t value);
 static void get_format_bytes(vg_lite_buffer_format_t format,
@@ -325,6 +870,33 @@ static void get_format_bytes(vg_lite_buffer_format_t format,
                              vg_lite_uint32_t * div,
                              vg_lite_uint32_t * bytes_align);
 
+static vg_lite_error_t ramp_image_prepare(vg_lite_ctx * ctx, const void * grad, vg_lite_buffer_t * image,
+                                          vg_lite_uint32_t width);
+static void ramp_image_release(vg_lite_ctx * ctx, const void * grad, vg_lite_buffer_t * image);
+static vg_lite_uint32_t ramp_get_width(const vg_lite_color_ramp_t * ramp, vg_lite_uint32_t length,
+                                       vg_lite_float_t extent);
+static void ramp_update(vg_lite_ctx * ctx, vg_lite_buffer_t * image, const vg_lite_ramp_stop_t * stops,
+                        vg_lite_uint32_t count, vg_lite_uint32_t width);
+static vg_lite_uint32_t ramp_convert(vg_lite_ramp_stop_t * stops, const vg_lite_color_ramp_t * ramp,
+                                     vg_lite_uint32_t length, vg_lite_uint32_t width, bool pre_multiplied);
+
+static Result linear_grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad);
+static Result linear_grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix);
+static Result radial_grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad);
+static Result radial_grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix);
+static Result grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad);
+static Result grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix);
+static vg_lite_uint32_t linear_grad_signature(const void * grad);
+static vg_lite_uint32_t radial_grad_signature(const void * grad);
+static vg_lite_uint32_t grad_signature(const void * grad);
+static vg_lite_fill_cache_t * fill_cache_find(vg_lite_ctx * ctx, const void * grad, fill_sign_cb_t sign);
+static vg_lite_fill_cache_t * fill_cache_update(vg_lite_ctx * ctx, const void * grad, fill_gen_cb_t gen,
+                                                fill_sign_cb_t sign);
+static void fill_cache_drop(vg_lite_ctx * ctx, const void * grad);
+static Result fill_cache_get(vg_lite_ctx * ctx, std::unique_ptr<Fill> & fill, const void * grad,
+                             const vg_lite_matrix_t * user_matrix, const vg_lite_matrix_t * path_matrix,
+                             fill_gen_cb_t gen, fill_sign_cb_t sign, fill_set_matrix_cb_t set_matrix);
+
 static vg_lite_fpoint_t matrix_transform_point(const vg_lite_matrix_t * matrix, const vg_lite_fpoint_t * point);
 static Result vg_lite_grad_matrix_conv(vg_lite_matrix_t * result, const vg_lite_matrix_t * grad_matrix,
                                        const vg_lite_matrix_t * path_matrix);
@@ -333,6 +905,19 @@ static Result vg_lite_grad_matrix_conv(vg_lite_matrix_t * result, const vg_lite_
  *  STATIC VARIABLES
  **********************/
 
+/* indexed by vg_lite_quality_t */
+static const vg_lite_quality_tier_t quality_tiers[] = {
+    { 1.0f / 16, 16 },  /* VG_LITE_HIGH */
+    { 1.0f / 8, 8 },    /* VG_LITE_UPPER */
+    { 1.0f / 4, 4 },    /* VG_LITE_MEDIUM */
+    { 1.0f, 1 },        /* VG_LITE_LOW */
+};
+
+static inline const vg_lite_quality_tier_t * quality_tier_get(vg_lite_quality_t quality)
+{
+    return &quality_tiers[quality <= VG_LITE_LOW ? quality : VG_LITE_HIGH];
+}
+
 /* color converters */
 
 static vg_lite_converter<vg_color16_t, vg_color32_t> conv_bgra8888_to_bgr565(
@@ -363,6 +948,49 @@ static vg_lite_converter<vg_color16_alpha_t, vg_color32_t> conv_bgra8888_to_bgra
 static vg_lite_converter<vg_color32_t, vg_color16_t> conv_bgr565_to_bgra8888(
     [](vg_color32_t * dest, const vg_color16_t * src, vg_lite_uint32_t px_size, vg_lite_uint32_t /* color */)
 {
+    /**
+     * 8 pixels at a time with the same truncated results as the loop below:
+     * c * 255 / 31 = 8 * c + (7 * c) / 31 and c * 255 / 63 = 4 * c + (3 * c) / 63,
+     * the small divisions are exact as (x * 265) >> 13 and (x * 261) >> 14 in 16 bits.
+     */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for(; px_size >= 8; px_size -= 8) {
+        uint16x8_t px = vld1q_u16((const uint16_t *)src);
+        uint16x8_t r = vshrq_n_u16(px, 11);
+        uint16x8_t g = vandq_u16(vshrq_n_u16(px, 5), vdupq_n_u16(0x3F));
+        uint16x8_t b = vandq_u16(px, vdupq_n_u16(0x1F));
+        uint8x8x4_t out;
+        out.val[0] = vmovn_u16(vaddq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(vmulq_n_u16(b, 7 * 265), 13)));
+        out.val[1] = vmovn_u16(vaddq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(vmulq_n_u16(g, 3 * 261), 14)));
+        out.val[2] = vmovn_u16(vaddq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(vmulq_n_u16(r, 7 * 265), 13)));
+        out.val[3] = vdup_n_u8(0xFF);
+        vst4_u8((uint8_t *)dest, out);
+        src += 8;
+        dest += 8;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+
+    for(; px_size >= 8; px_size -= 8) {
+        __m128i px = _mm_loadu_si128((const __m128i *)src);
+        __m128i r = _mm_srli_epi16(px, 11);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(px, 5), _mm_set1_epi16(0x3F));
+        __m128i b = _mm_and_si128(px, mask5);
+        r = _mm_add_epi16(_mm_slli_epi16(r, 3), _mm_srli_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(7 * 265)), 13));
+        g = _mm_add_epi16(_mm_slli_epi16(g, 2), _mm_srli_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(3 * 261)), 14));
+        b = _mm_add_epi16(_mm_slli_epi16(b, 3), _mm_srli_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(7 * 265)), 13));
+
+        /* B G and R A pairs, interleaved into the pixels */
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i ra = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dest + 4), _mm_unpackhi_epi16(bg, ra));
+        src += 8;
+        dest += 8;
+    }
+#endif
+
     while(px_size--) {
         dest->red = src->red * 0xFF / 0x1F;
         dest->green = src->green * 0xFF / 0x3F;
@@ -459,6 +1087,8 @@ static vg_lite_converter<vg_color32_t, vg_color32_t> conv_rgba8888_to_bgra8888(
         dest->red = src->blue;
         dest->green = src->green;
         dest->blue = src->red;
+        src++;
+        dest++;
     }
 });
 
@@ -541,11 +1171,24 @@ extern "C" {
     void gpu_deinit(void)
     {
         LV_ASSERT_NULL(vg_lite_ctx::g_context);
+        pool_trim(vg_lite_ctx::g_context, 0);
         delete vg_lite_ctx::g_context;
         vg_lite_ctx::g_context = nullptr;
         vg_lite_close();
     }
 
+    vg_lite_uint32_t gpu_get_culled_count(void)
+    {
+        LV_ASSERT_NULL(vg_lite_ctx::g_context);
+        return vg_lite_ctx::g_context->culled_count;
+    }
+
+    vg_lite_uint32_t gpu_get_mem_peak(void)
+    {
+        LV_ASSERT_NULL(vg_lite_ctx::g_context);
+        return (vg_lite_uint32_t)vg_lite_ctx::g_context->pool.peak_size;
+    }
+
     vg_lite_error_t vg_lite_allocate(vg_lite_buffer_t * buffer)
     {
         if(buffer->format == VG_LITE_RGBA8888_ETC2_EAC && (buffer->width % 16 || buffer->height % 4)) {
@@ -573,14 +1216,14 @@ extern "C" {
 
         buffer->stride = stride;
 
-        /* Size must be multiple of align, See: https://en.cppreference.com/w/c/memory/aligned_alloc */
-        size_t size = VG_LITE_ALIGN(buffer->height * stride, LV_VG_LITE_THORVG_BUF_ADDR_ALIGN);
-#ifndef _WIN32
-        buffer->memory = aligned_alloc(LV_VG_LITE_THORVG_BUF_ADDR_ALIGN, size);
-#else
-        buffer->memory = _aligned_malloc(size, LV_VG_LITE_THORVG_BUF_ADDR_ALIGN);
-#endif
-        LV_ASSERT(buffer->memory);
+        /**
+         * The blocks share the address alignment, above the stride alignment of every format,
+         * so that a released block serves the next buffer of its size class whatever the format.
+         */
+        size_t size = (size_t)buffer->height * stride;
+        vg_lite_error_t error;
+        VG_LITE_RETURN_ERROR(pool_alloc(vg_lite_ctx::get_instance(), size, &buffer->memory));
+
         buffer->address = (vg_lite_uint32_t)(uintptr_t)buffer->memory;
         buffer->handle = buffer->memory;
         return VG_LITE_SUCCESS;
@@ -589,11 +1232,22 @@ extern "C" {
     vg_lite_error_t vg_lite_free(vg_lite_buffer_t * buffer)
     {
         LV_ASSERT(buffer->memory);
-#ifndef _WIN32
-        free(buffer->memory);
-#else
-        _aligned_free(buffer->memory);
-#endif
+        auto ctx = vg_lite_ctx::get_instance();
+        mip_cache_drop(ctx, buffer);
+
+        if(ctx->masklayer == buffer) {
+            ctx->masklayer = nullptr;
+            mask_update(ctx);
+        }
+
+        if(!pool_free(ctx, buffer->memory)) {
+            /* not a buffer of vg_lite_allocate() */
+            LV_ASSERT(false);
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        ctx->ramp_images.erase(buffer->memory);
+
         memset(buffer, 0, sizeof(vg_lite_buffer_t));
         return VG_LITE_SUCCESS;
     }
@@ -608,16 +1262,161 @@ extern "C" {
 
     vg_lite_error_t vg_lite_map(vg_lite_buffer_t * buffer, vg_lite_map_flag_t flag, int32_t fd)
     {
-        LV_UNUSED(buffer);
-        LV_UNUSED(flag);
-        LV_UNUSED(fd);
-        return VG_LITE_NOT_SUPPORT;
+        if(!buffer || buffer->width <= 0 || buffer->height <= 0) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        if(buffer->stride == 0) {
+            /* laid out as vg_lite_allocate() would */
+            vg_lite_uint32_t mul, div, align;
+            get_format_bytes(buffer->format, &mul, &div, &align);
+            buffer->stride = VG_LITE_ALIGN((buffer->width * mul / div), align);
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+        vg_lite_mapping_t mapping = { 0, -1, false, false };
+
+        switch(flag) {
+            case VG_LITE_MAP_USER_MEMORY:
+                /* the memory stays the caller's, it is only wrapped */
+                if(!buffer->memory) {
+                    return VG_LITE_INVALID_ARGUMENT;
+                }
+                break;
+
+            case VG_LITE_MAP_DMABUF: {
+#ifndef _WIN32
+                    /**
+                     * A memfd or a dma-buf of another process, mapped shared so that its frames are drawn
+                     * and sampled in place. The fd is kept for the cache synchronization of the dma-buf.
+                     */
+                    mapping.size = (size_t)buffer->height * buffer->stride;
+
+                    struct stat st;
+                    if(fd < 0 || fstat(fd, &st) != 0) {
+                        return VG_LITE_INVALID_ARGUMENT;
+                    }
+
+                    /* a dma-buf gives its size by seeking to its end, only a regular file has it in st_size */
+                    off_t fd_size = st.st_size;
+                    if(!S_ISREG(st.st_mode)) {
+                        fd_size = lseek(fd, 0, SEEK_END);
+                        lseek(fd, 0, SEEK_SET);
+                    }
+
+                    /* the pages beyond the end of the file fault on access */
+                    if(fd_size < 0 || (size_t)fd_size < mapping.size) {
+                        return VG_LITE_INVALID_ARGUMENT;
+                    }
+
+                    void * memory = mmap(NULL, mapping.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                    if(memory == MAP_FAILED) {
+                        return VG_LITE_OUT_OF_RESOURCES;
+                    }
+
+                    mapping.fd = dup(fd);
+                    if(mapping.fd < 0) {
+                        munmap(memory, mapping.size);
+                        return VG_LITE_OUT_OF_RESOURCES;
+                    }
+
+                    /* the CPU access is only started by the draws, an empty one tells whether the fd is a dma-buf */
+                    mapping.dmabuf = mapping_sync(&mapping, true) && mapping_sync(&mapping, false);
+                    buffer->memory = memory;
+                    break;
+#else
+                    LV_UNUSED(fd);
+                    return VG_LITE_NOT_SUPPORT;
+#endif
+                }
+
+            default:
+                return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        ctx->mappings[buffer->memory] = mapping;
+        buffer->address = (vg_lite_uint32_t)(uintptr_t)buffer->memory;
+        buffer->handle = buffer->memory;
+        return VG_LITE_SUCCESS;
     }
 
     vg_lite_error_t vg_lite_unmap(vg_lite_buffer_t * buffer)
     {
-        LV_UNUSED(buffer);
-        return VG_LITE_NOT_SUPPORT;
+        if(!buffer) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+        auto it = ctx->mappings.find(buffer->memory);
+        if(it == ctx->mappings.end()) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* the drawing pending on it lands before the memory goes */
+        if(ctx->target_buffer == buffer->memory) {
+            vg_lite_error_t error;
+            VG_LITE_RETURN_ERROR(vg_lite_finish());
+        }
+
+        mip_cache_drop(ctx, buffer);
+
+        if(ctx->masklayer == buffer) {
+            ctx->masklayer = nullptr;
+            mask_update(ctx);
+        }
+
+#ifndef _WIN32
+        if(it->second.fd >= 0) {
+            if(it->second.synced) {
+                mapping_sync(&it->second, false);
+            }
+
+            munmap(buffer->memory, it->second.size);
+            close(it->second.fd);
+            buffer->memory = nullptr;
+        }
+#endif
+
+        ctx->mappings.erase(it);
+        buffer->address = 0;
+        buffer->handle = nullptr;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_flush_mapped_buffer(vg_lite_buffer_t * buffer)
+    {
+        if(!buffer) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+        auto it = ctx->mappings.find(buffer->memory);
+        if(it == ctx->mappings.end()) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* the other side reads what was drawn so far, the draws end their CPU access in vg_lite_finish() */
+        if(ctx->target_buffer == buffer->memory) {
+            vg_lite_error_t error;
+            VG_LITE_RETURN_ERROR(vg_lite_finish());
+        }
+
+        /* and its writes are seen here: a CPU access of a dma-buf syncs the caches when it starts and ends */
+        if(it->second.synced) {
+            mapping_sync(&it->second, false);
+            it->second.synced = false;
+        }
+
+        bool synced = it->second.dmabuf && mapping_sync(&it->second, true);
+
+        /* the mipmaps were made from the contents before */
+        mip_cache_drop(ctx, buffer);
+
+        if(synced) {
+            mapping_sync(&it->second, false);
+        }
+
+        return VG_LITE_SUCCESS;
     }
 
     vg_lite_error_t vg_lite_clear(vg_lite_buffer_t * target, vg_lite_rectangle_t * rectangle, vg_lite_color_t color)
@@ -627,9 +1426,8 @@ extern "C" {
 
         auto shape = Shape::gen();
         TVG_CHECK_RETURN_VG_ERROR(shape_append_rect(shape, target, rectangle));
-        TVG_CHECK_RETURN_VG_ERROR(shape->blend(BlendMethod::SrcOver));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(TVG_COLOR(color)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(shape), VG_LITE_BLEND_NONE));
 
         return VG_LITE_SUCCESS;
     }
@@ -641,16 +1439,33 @@ extern "C" {
                                  vg_lite_color_t color,
                                  vg_lite_filter_t filter)
     {
-        LV_UNUSED(filter);
         auto ctx = vg_lite_ctx::get_instance();
+
+        vg_lite_matrix_t mirrored;
+        matrix = mirror_apply(ctx, matrix, (vg_lite_float_t)source->height, &mirrored);
+
+        vg_lite_fbox_t box = { 0, 0, (vg_lite_float_t)source->width, (vg_lite_float_t)source->height };
+        if(draw_is_culled(ctx, target, &box, matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         canvas_set_target(ctx, target);
 
+        Result raster_res = raster_blit(ctx, target, source, nullptr, matrix, blend, color, filter);
+        if(raster_res == Result::NonSupport) {
+            raster_res = raster_blit_transform(ctx, target, source, nullptr, matrix, blend, color, filter);
+        }
+
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
+
         auto picture = Picture::gen();
 
         TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color));
         TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(matrix)));
-        TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(picture), blend));
 
         return VG_LITE_SUCCESS;
     }
@@ -667,6 +1482,20 @@ extern "C" {
             return VG_LITE_NOT_SUPPORT;
         }
 
+        auto ctx = vg_lite_ctx::get_instance();
+        TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
+
+        /* the fallback below mirrors the matrices on its own */
+        vg_lite_matrix_t mirrored[2];
+        Result raster_res = raster_blit2(ctx, target, source0, source1,
+                                         mirror_apply(ctx, matrix0, (vg_lite_float_t)source0->height, &mirrored[0]),
+                                         mirror_apply(ctx, matrix1, (vg_lite_float_t)source1->height, &mirrored[1]),
+                                         blend, filter);
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
+
         vg_lite_error_t error;
 
         VG_LITE_RETURN_ERROR(vg_lite_blit(target, source0, matrix0, blend, 0, filter));
@@ -675,17 +1504,96 @@ extern "C" {
         return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_blit_rect(vg_lite_buffer_t * target,
-                                      vg_lite_buffer_t * source,
-                                      vg_lite_rectangle_t * rect,
-                                      vg_lite_matrix_t * matrix,
-                                      vg_lite_blend_t blend,
-                                      vg_lite_color_t color,
-                                      vg_lite_filter_t filter)
+    vg_lite_error_t vg_lite_copy_image(vg_lite_buffer_t * target,
+                                       vg_lite_buffer_t * source,
+                                       vg_lite_int32_t sx,
+                                       vg_lite_int32_t sy,
+                                       vg_lite_int32_t dx,
+                                       vg_lite_int32_t dy,
+                                       vg_lite_int32_t width,
+                                       vg_lite_int32_t height)
     {
-        LV_UNUSED(filter);
-        auto ctx = vg_lite_ctx::get_instance();
-        TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
+        if(!target || !source || !target->memory || !source->memory) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* the rectangle is clipped to both buffers */
+        int32_t left = MIN(sx, dx);
+        if(left < 0) {
+            sx -= left;
+            dx -= left;
+            width += left;
+        }
+
+        int32_t top = MIN(sy, dy);
+        if(top < 0) {
+            sy -= top;
+            dy -= top;
+            height += top;
+        }
+
+        width = MIN(width, MIN((int32_t)source->width - sx, (int32_t)target->width - dx));
+        height = MIN(height, MIN((int32_t)source->height - sy, (int32_t)target->height - dy));
+
+        if(width <= 0 || height <= 0) {
+            return VG_LITE_SUCCESS;
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+
+        /**
+         * The paints pending on another target stay queued, they have their own copy of the images.
+         * Only the bound target is brought up to date when it is read or written here.
+         */
+        if(ctx->target_buffer && (ctx->target_buffer == target->memory || ctx->target_buffer == source->memory)) {
+            if(TVG_IS_VG_FMT_SUPPORT(ctx->target_format)) {
+                TVG_CHECK_RETURN_VG_ERROR(canvas_flush(ctx));
+            }
+            else {
+                /* the drawing is in the internal buffer until it is converted */
+                vg_lite_error_t error;
+                VG_LITE_RETURN_ERROR(vg_lite_finish());
+            }
+        }
+
+        mip_cache_drop(ctx, target);
+        mapping_begin(ctx, target);
+        mapping_begin(ctx, source);
+        TVG_CHECK_RETURN_VG_ERROR(image_copy(ctx, target, source, sx, sy, dx, dy, width, height));
+
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_blit_rect(vg_lite_buffer_t * target,
+                                      vg_lite_buffer_t * source,
+                                      vg_lite_rectangle_t * rect,
+                                      vg_lite_matrix_t * matrix,
+                                      vg_lite_blend_t blend,
+                                      vg_lite_color_t color,
+                                      vg_lite_filter_t filter)
+    {
+        auto ctx = vg_lite_ctx::get_instance();
+
+        vg_lite_matrix_t mirrored;
+        matrix = mirror_apply(ctx, matrix, (vg_lite_float_t)rect->height, &mirrored);
+
+        /* the visible area is the rect moved to the origin of the matrix */
+        vg_lite_fbox_t box = { 0, 0, (vg_lite_float_t)rect->width, (vg_lite_float_t)rect->height };
+        if(draw_is_culled(ctx, target, &box, matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
+        TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
+
+        Result raster_res = raster_blit(ctx, target, source, rect, matrix, blend, color, filter);
+        if(raster_res == Result::NonSupport) {
+            raster_res = raster_blit_transform(ctx, target, source, rect, matrix, blend, color, filter);
+        }
+
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
 
         vg_lite_matrix_t new_matrix = *matrix;
         if(rect->x || rect->y) {
@@ -700,9 +1608,8 @@ extern "C" {
         auto picture = tvg::Picture::gen();
         TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color));
         TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(&new_matrix)));
-        TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
         TVG_CHECK_RETURN_VG_ERROR(picture->composite(std::move(shape), CompositeMethod::ClipPath));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(picture), blend));
 
         return VG_LITE_SUCCESS;
     }
@@ -736,6 +1643,45 @@ extern "C" {
 
     static void picture_bgra8888_to_bgr565(vg_color16_t * dest, const vg_color32_t * src, vg_lite_uint32_t px_size)
     {
+        /* 8 pixels at a time, c * 31 / 255 truncated is (x + 1 + (x >> 8)) >> 8 with x = c * 31 */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        for(; px_size >= 8; px_size -= 8) {
+            uint8x8x4_t px = vld4_u8((const uint8_t *)src);
+            uint16x8_t r = vmull_u8(px.val[2], vdup_n_u8(31));
+            uint16x8_t g = vmull_u8(px.val[1], vdup_n_u8(63));
+            uint16x8_t b = vmull_u8(px.val[0], vdup_n_u8(31));
+            r = vshrq_n_u16(vaddq_u16(vaddq_u16(r, vdupq_n_u16(1)), vshrq_n_u16(r, 8)), 8);
+            g = vshrq_n_u16(vaddq_u16(vaddq_u16(g, vdupq_n_u16(1)), vshrq_n_u16(g, 8)), 8);
+            b = vshrq_n_u16(vaddq_u16(vaddq_u16(b, vdupq_n_u16(1)), vshrq_n_u16(b, 8)), 8);
+            vst1q_u16((uint16_t *)dest, vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b));
+            src += 8;
+            dest += 8;
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128i mask8 = _mm_set1_epi32(0xFF);
+        const __m128i one = _mm_set1_epi16(1);
+
+        for(; px_size >= 8; px_size -= 8) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)src);
+            __m128i hi = _mm_loadu_si128((const __m128i *)(src + 4));
+            __m128i r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask8),
+                                        _mm_and_si128(_mm_srli_epi32(hi, 16), mask8));
+            __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask8),
+                                        _mm_and_si128(_mm_srli_epi32(hi, 8), mask8));
+            __m128i b = _mm_packs_epi32(_mm_and_si128(lo, mask8), _mm_and_si128(hi, mask8));
+            r = _mm_mullo_epi16(r, _mm_set1_epi16(31));
+            g = _mm_mullo_epi16(g, _mm_set1_epi16(63));
+            b = _mm_mullo_epi16(b, _mm_set1_epi16(31));
+            r = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(r, one), _mm_srli_epi16(r, 8)), 8);
+            g = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(g, one), _mm_srli_epi16(g, 8)), 8);
+            b = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b, one), _mm_srli_epi16(b, 8)), 8);
+            __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+            _mm_storeu_si128((__m128i *)dest, out);
+            src += 8;
+            dest += 8;
+        }
+#endif
+
         while(px_size--) {
             dest->red = src->red * 0x1F / 0xFF;
             dest->green = src->green * 0x3F / 0xFF;
@@ -827,17 +1773,14 @@ extern "C" {
     {
         vg_lite_ctx * ctx = vg_lite_ctx::get_instance();
 
-        if(ctx->canvas->draw() == Result::InsufficientCondition) {
+        TVG_CHECK_RETURN_VG_ERROR(canvas_flush(ctx));
+
+        if(!ctx->target_dirty) {
+            /* nothing was drawn */
+            mapping_end(ctx);
             return VG_LITE_SUCCESS;
         }
 
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->sync());
-#if LV_VG_LITE_THORVG_USE_RELEASE
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->clear(true));
-#else
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->clear(true, false));
-#endif
-
         /* make sure target buffer is valid */
         LV_ASSERT_NULL(ctx->target_buffer);
 
@@ -902,7 +1845,9 @@ extern "C" {
         ctx->target_buffer = nullptr;
         ctx->tvg_target_buffer = nullptr;
         ctx->target_px_size = 0;
+        ctx->target_dirty = false;
 
+        mapping_end(ctx);
         return VG_LITE_SUCCESS;
     }
 
@@ -919,15 +1864,40 @@ extern "C" {
                                  vg_lite_color_t color)
     {
         auto ctx = vg_lite_ctx::get_instance();
+        color = color_transform_apply(ctx, color);
+
+        if(path_is_culled(ctx, target, path, matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+        /**
+         * Rectangles and rounded rectangles are filled analytically at any quality,
+         * LOW and MEDIUM quality fills are handled by the built-in rasterizer.
+         */
+        vg_lite_raster_paint_t paint = { color_premultiply(color), blend, nullptr, 0, 0, 0, 0 };
+        Result raster_res = raster_draw_rrect(ctx, target, path, matrix, &paint);
+        if(raster_res == Result::NonSupport) {
+            raster_res = raster_draw_path(ctx, target, path, fill_rule, matrix, &paint);
+        }
+
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
+
         auto shape = Shape::gen();
-        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix));
+        vg_lite_fbox_t bounds;
+        vg_lite_fbox_t extent;
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix, &bounds, &extent));
         TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
-        TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(TVG_COLOR(color)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+
+        /* a solid paint tells its coverage apart from its alpha if it is composited afterwards */
+        vg_lite_uint32_t alpha = A(path->path_type == VG_LITE_DRAW_STROKE_PATH ? path->stroke_color : color);
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(shape), blend, &bounds, &extent, alpha));
 
         return VG_LITE_SUCCESS;
     }
@@ -1029,6 +1999,7 @@ extern "C" {
             case gcFEATURE_BIT_VG_RADIAL_GRADIENT:
             case gcFEATURE_BIT_VG_IM_REPEAT_REFLECT:
             case gcFEATURE_BIT_VG_SCISSOR:
+            case gcFEATURE_BIT_VG_DOUBLE_IMAGE:
 
 #if LV_VG_LITE_THORVG_LVGL_BLEND_SUPPORT
             case gcFEATURE_BIT_VG_LVGL_SUPPORT:
@@ -1110,6 +2081,11 @@ extern "C" {
     {
         LV_ASSERT_NULL(path);
 
+        auto ctx = vg_lite_ctx::get_instance();
+        if(ctx) {
+            path_drop_lod(ctx, path);
+        }
+
         if(path->stroke) {
             lv_free(path->stroke);
             path->stroke = NULL;
@@ -1171,24 +2147,33 @@ extern "C" {
                                          vg_lite_color_t color,
                                          vg_lite_filter_t filter)
     {
-        LV_UNUSED(pattern_mode);
-        LV_UNUSED(pattern_color);
-        LV_UNUSED(filter);
-
         auto ctx = vg_lite_ctx::get_instance();
+
+        if(path_is_culled(ctx, target, path, path_matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+        Result raster_res = raster_draw_pattern(ctx, target, path, fill_rule, path_matrix, pattern_image, pattern_matrix,
+                                                blend, pattern_mode, pattern_color, color, filter);
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
+
         auto shape = Shape::gen();
-        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix));
+        vg_lite_fbox_t bounds;
+        vg_lite_fbox_t extent;
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix, &bounds, &extent));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)));
         TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(path_matrix)));
 
         auto picture = tvg::Picture::gen();
         TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, pattern_image, color));
         TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(pattern_matrix)));
-        TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
         TVG_CHECK_RETURN_VG_ERROR(picture->composite(std::move(shape), CompositeMethod::ClipPath));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(picture), blend, &bounds, &extent));
 
         return VG_LITE_SUCCESS;
     }
@@ -1198,6 +2183,7 @@ extern "C" {
         vg_lite_error_t error = VG_LITE_SUCCESS;
 
         /* Set the member values according to driver defaults. */
+        memset(&grad->image, 0, sizeof(grad->image));
         grad->image.width = VLC_GRADIENT_BUFFER_WIDTH;
         grad->image.height = 1;
         grad->image.stride = 0;
@@ -1241,6 +2227,12 @@ extern "C" {
         if((linear_gradient.X0 == linear_gradient.X1) && (linear_gradient.Y0 == linear_gradient.Y1))
             return VG_LITE_INVALID_ARGUMENT;
 
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
+        /* the image left by an earlier update is released, whatever else the struct holds is not ours */
+        ramp_image_release(vg_lite_ctx::get_instance(), grad, &grad->image);
+        memset(&grad->image, 0, sizeof(grad->image));
+
         grad->linear_grad = linear_gradient;
         grad->pre_multiplied = pre_multiplied;
         grad->spread_mode = spread_mode;
@@ -1342,18 +2334,12 @@ Empty_sequence_handler:
 
     vg_lite_error_t vg_lite_update_linear_grad(vg_lite_ext_linear_gradient_t * grad)
     {
-        vg_lite_uint32_t ramp_length;
-        vg_lite_color_ramp_t * color_ramp;
-        vg_lite_uint32_t common, stop;
-        vg_lite_uint32_t i, width;
-        uint8_t * bits;
+        auto ctx = vg_lite_ctx::get_instance();
+        vg_lite_ramp_stop_t stops[VLC_MAX_COLOR_RAMP_STOPS + 2];
+        vg_lite_uint32_t count, width;
         vg_lite_float_t x0, y0, x1, y1, length;
         vg_lite_error_t error = VG_LITE_SUCCESS;
 
-        /* Get shortcuts to the color ramp. */
-        ramp_length = grad->converted_length;
-        color_ramp = grad->converted_ramp;
-
         x0 = grad->linear_grad.X0;
         y0 = grad->linear_grad.Y0;
         x1 = grad->linear_grad.X1;
@@ -1362,119 +2348,18 @@ Empty_sequence_handler:
 
         if(length <= 0)
             return VG_LITE_INVALID_ARGUMENT;
-        /* Find the common denominator of the color ramp stops. */
-        if(length < 1) {
-            common = 1;
-        }
-        else {
-            common = (vg_lite_uint32_t)length;
-        }
-
-        for(i = 0; i < ramp_length; ++i) {
-            if(color_ramp[i].stop != 0.0f) {
-                vg_lite_float_t mul = common * color_ramp[i].stop;
-                vg_lite_float_t frac = mul - (vg_lite_float_t)floor(mul);
-                if(frac > 0.00013f) { /* Suppose error for zero is 0.00013 */
-                    common = MAX(common, (vg_lite_uint32_t)(1.0f / frac + 0.5f));
-                }
-            }
-        }
 
         /* Compute the width of the required color array. */
-        width = common + 1;
+        width = ramp_get_width(grad->converted_ramp, grad->converted_length, length);
 
         /* Allocate the color ramp surface. */
-        memset(&grad->image, 0, sizeof(grad->image));
-        grad->image.width = width;
-        grad->image.height = 1;
-        grad->image.stride = 0;
-        grad->image.image_mode = VG_LITE_NONE_IMAGE_MODE;
-        grad->image.format = VG_LITE_ABGR8888;
-
-        /* Allocate the image for gradient. */
-        VG_LITE_RETURN_ERROR(vg_lite_allocate(&grad->image));
-        memset(grad->image.memory, 0, grad->image.stride * grad->image.height);
-        width = common + 1;
-        /* Set pointer to color array. */
-        bits = (uint8_t *)grad->image.memory;
-
-        /* Start filling the color array. */
-        stop = 0;
-        for(i = 0; i < width; ++i) {
-            vg_lite_float_t gradient;
-            vg_lite_float_t color[4];
-            vg_lite_float_t color1[4];
-            vg_lite_float_t color2[4];
-            vg_lite_float_t weight;
-
-            if(i == 241)
-                i = 241;
-            /* Compute gradient for current color array entry. */
-            gradient = (vg_lite_float_t)i / (vg_lite_float_t)(width - 1);
-
-            /* Find the entry in the color ramp that matches or exceeds this
-            ** gradient. */
-            while(gradient > color_ramp[stop].stop) {
-                ++stop;
-            }
-
-            if(gradient == color_ramp[stop].stop) {
-                /* Perfect match weight 1.0. */
-                weight = 1.0f;
-
-                /* Use color ramp color. */
-                color1[3] = color_ramp[stop].alpha;
-                color1[2] = color_ramp[stop].blue;
-                color1[1] = color_ramp[stop].green;
-                color1[0] = color_ramp[stop].red;
-
-                color2[3] = color2[2] = color2[1] = color2[0] = 0.0f;
-            }
-            else {
-                if(stop == 0) {
-                    return VG_LITE_INVALID_ARGUMENT;
-                }
-                /* Compute weight. */
-                weight = (color_ramp[stop].stop - gradient)
-                         / (color_ramp[stop].stop - color_ramp[stop - 1].stop);
-
-                /* Grab color ramp color of previous stop. */
-                color1[3] = color_ramp[stop - 1].alpha;
-                color1[2] = color_ramp[stop - 1].blue;
-                color1[1] = color_ramp[stop - 1].green;
-                color1[0] = color_ramp[stop - 1].red;
-
-                /* Grab color ramp color of current stop. */
-                color2[3] = color_ramp[stop].alpha;
-                color2[2] = color_ramp[stop].blue;
-                color2[1] = color_ramp[stop].green;
-                color2[0] = color_ramp[stop].red;
-            }
-
-            if(grad->pre_multiplied) {
-                /* Pre-multiply the first color. */
-                color1[2] *= color1[3];
-                color1[1] *= color1[3];
-                color1[0] *= color1[3];
-
-                /* Pre-multiply the second color. */
-                color2[2] *= color2[3];
-                color2[1] *= color2[3];
-                color2[0] *= color2[3];
-            }
+        VG_LITE_RETURN_ERROR(ramp_image_prepare(ctx, grad, &grad->image, width));
 
-            /* Filter the colors per channel. */
-            color[3] = LERP(color1[3], color2[3], weight);
-            color[2] = LERP(color1[2], color2[2], weight);
-            color[1] = LERP(color1[1], color2[1], weight);
-            color[0] = LERP(color1[0], color2[0], weight);
+        /* Fill the color array from the stops. */
+        count = ramp_convert(stops, grad->converted_ramp, grad->converted_length, width, grad->pre_multiplied);
+        ramp_update(ctx, &grad->image, stops, count, width);
 
-            /* Pack the final color. */
-            *bits++ = PackColorComponent(color[3]);
-            *bits++ = PackColorComponent(color[2]);
-            *bits++ = PackColorComponent(color[1]);
-            *bits++ = PackColorComponent(color[0]);
-        }
+        fill_cache_update(ctx, grad, linear_grad_gen_fill, linear_grad_signature);
 
         return VG_LITE_SUCCESS;
     }
@@ -1492,35 +2377,26 @@ Empty_sequence_handler:
         LV_UNUSED(filter);
 
         auto ctx = vg_lite_ctx::get_instance();
+
+        if(path_is_culled(ctx, target, path, path_matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
         auto shape = Shape::gen();
-        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix));
+        vg_lite_fbox_t bounds;
+        vg_lite_fbox_t extent;
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix, &bounds, &extent));
         TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(path_matrix)));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
-        TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
-
-        vg_lite_matrix_t grad_matrix;
-        TVG_CHECK_RETURN_VG_ERROR(vg_lite_grad_matrix_conv(&grad_matrix, &grad->matrix, path_matrix));
 
-        auto linearGrad = LinearGradient::gen();
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->linear(grad->linear_grad.X0, grad->linear_grad.Y0, grad->linear_grad.X1,
-                                                     grad->linear_grad.Y1));
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->transform(matrix_conv(&grad_matrix)));
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->spread(fill_spread_conv(grad->spread_mode)));
-
-        tvg::Fill::ColorStop colorStops[VLC_MAX_COLOR_RAMP_STOPS];
-        for(vg_lite_uint32_t i = 0; i < grad->ramp_length; i++) {
-            colorStops[i].offset = grad->color_ramp[i].stop;
-            colorStops[i].r = grad->color_ramp[i].red * 255.0f;
-            colorStops[i].g = grad->color_ramp[i].green * 255.0f;
-            colorStops[i].b = grad->color_ramp[i].blue * 255.0f;
-            colorStops[i].a = grad->color_ramp[i].alpha * 255.0f;
-        }
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->colorStops(colorStops, grad->ramp_length));
+        std::unique_ptr<Fill> linearGrad;
+        TVG_CHECK_RETURN_VG_ERROR(fill_cache_get(ctx, linearGrad, grad, &grad->matrix, path_matrix,
+                                                 linear_grad_gen_fill, linear_grad_signature, linear_grad_set_matrix));
 
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(std::move(linearGrad)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(shape), blend, &bounds, &extent));
 
         return VG_LITE_SUCCESS;
     }
@@ -1555,6 +2431,12 @@ Empty_sequence_handler:
         if(radial_grad.r <= 0)
             return VG_LITE_INVALID_ARGUMENT;
 
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
+        /* the image left by an earlier update is released, whatever else the struct holds is not ours */
+        ramp_image_release(vg_lite_ctx::get_instance(), grad, &grad->image);
+        memset(&grad->image, 0, sizeof(grad->image));
+
         grad->radial_grad = radial_grad;
         grad->pre_multiplied = pre_multiplied;
         grad->spread_mode = spread_mode;
@@ -1656,132 +2538,30 @@ Empty_sequence_handler:
 
     vg_lite_error_t vg_lite_update_radial_grad(vg_lite_radial_gradient_t * grad)
     {
-        vg_lite_uint32_t ramp_length;
-        vg_lite_color_ramp_t * colorRamp;
-        vg_lite_uint32_t common, stop;
-        vg_lite_uint32_t i, width;
-        uint8_t * bits;
+        auto ctx = vg_lite_ctx::get_instance();
+        vg_lite_ramp_stop_t stops[VLC_MAX_COLOR_RAMP_STOPS + 2];
+        vg_lite_uint32_t count, width;
         vg_lite_error_t error = VG_LITE_SUCCESS;
         vg_lite_uint32_t align, mul, div;
 
-        /* Get shortcuts to the color ramp. */
-        ramp_length = grad->converted_length;
-        colorRamp = grad->converted_ramp;
-
         if(grad->radial_grad.r <= 0)
             return VG_LITE_INVALID_ARGUMENT;
 
-        /* Find the common denominator of the color ramp stops. */
-        if(grad->radial_grad.r < 1) {
-            common = 1;
-        }
-        else {
-            common = (vg_lite_uint32_t)grad->radial_grad.r;
-        }
-
-        for(i = 0; i < ramp_length; ++i) {
-            if(colorRamp[i].stop != 0.0f) {
-                vg_lite_float_t m = common * colorRamp[i].stop;
-                vg_lite_float_t frac = m - (vg_lite_float_t)floor(m);
-                if(frac > 0.00013f) { /* Suppose error for zero is 0.00013 */
-                    common = MAX(common, (vg_lite_uint32_t)(1.0f / frac + 0.5f));
-                }
-            }
-        }
-
         /* Compute the width of the required color array. */
-        width = common + 1;
+        width = ramp_get_width(grad->converted_ramp, grad->converted_length, grad->radial_grad.r);
         width = (width + 15) & (~0xf);
 
         /* Allocate the color ramp surface. */
-        memset(&grad->image, 0, sizeof(grad->image));
-        grad->image.width = width;
-        grad->image.height = 1;
-        grad->image.stride = 0;
-        grad->image.image_mode = VG_LITE_NONE_IMAGE_MODE;
-        grad->image.format = VG_LITE_ABGR8888;
-
-        /* Allocate the image for gradient. */
-        VG_LITE_RETURN_ERROR(vg_lite_allocate(&grad->image));
+        VG_LITE_RETURN_ERROR(ramp_image_prepare(ctx, grad, &grad->image, width));
 
         get_format_bytes(VG_LITE_ABGR8888, &mul, &div, &align);
         width = grad->image.stride * div / mul;
 
-        /* Set pointer to color array. */
-        bits = (uint8_t *)grad->image.memory;
-
-        /* Start filling the color array. */
-        stop = 0;
-        for(i = 0; i < width; ++i) {
-            vg_lite_float_t gradient;
-            vg_lite_float_t color[4];
-            vg_lite_float_t color1[4];
-            vg_lite_float_t color2[4];
-            vg_lite_float_t weight;
-
-            /* Compute gradient for current color array entry. */
-            gradient = (vg_lite_float_t)i / (vg_lite_float_t)(width - 1);
+        /* Fill the color array from the stops. */
+        count = ramp_convert(stops, grad->converted_ramp, grad->converted_length, width, grad->pre_multiplied);
+        ramp_update(ctx, &grad->image, stops, count, width);
 
-            /* Find the entry in the color ramp that matches or exceeds this
-            ** gradient. */
-            while(gradient > colorRamp[stop].stop) {
-                ++stop;
-            }
-
-            if(gradient == colorRamp[stop].stop) {
-                /* Perfect match weight 1.0. */
-                weight = 1.0f;
-
-                /* Use color ramp color. */
-                color1[3] = colorRamp[stop].alpha;
-                color1[2] = colorRamp[stop].blue;
-                color1[1] = colorRamp[stop].green;
-                color1[0] = colorRamp[stop].red;
-
-                color2[3] = color2[2] = color2[1] = color2[0] = 0.0f;
-            }
-            else {
-                /* Compute weight. */
-                weight = (colorRamp[stop].stop - gradient)
-                         / (colorRamp[stop].stop - colorRamp[stop - 1].stop);
-
-                /* Grab color ramp color of previous stop. */
-                color1[3] = colorRamp[stop - 1].alpha;
-                color1[2] = colorRamp[stop - 1].blue;
-                color1[1] = colorRamp[stop - 1].green;
-                color1[0] = colorRamp[stop - 1].red;
-
-                /* Grab color ramp color of current stop. */
-                color2[3] = colorRamp[stop].alpha;
-                color2[2] = colorRamp[stop].blue;
-                color2[1] = colorRamp[stop].green;
-                color2[0] = colorRamp[stop].red;
-            }
-
-            if(grad->pre_multiplied) {
-                /* Pre-multiply the first color. */
-                color1[2] *= color1[3];
-                color1[1] *= color1[3];
-                color1[0] *= color1[3];
-
-                /* Pre-multiply the second color. */
-                color2[2] *= color2[3];
-                color2[1] *= color2[3];
-                color2[0] *= color2[3];
-            }
-
-            /* Filter the colors per channel. */
-            color[3] = LERP(color1[3], color2[3], weight);
-            color[2] = LERP(color1[2], color2[2], weight);
-            color[1] = LERP(color1[1], color2[1], weight);
-            color[0] = LERP(color1[0], color2[0], weight);
-
-            /* Pack the final color. */
-            *bits++ = PackColorComponent(color[3]);
-            *bits++ = PackColorComponent(color[2]);
-            *bits++ = PackColorComponent(color[1]);
-            *bits++ = PackColorComponent(color[0]);
-        }
+        fill_cache_update(ctx, grad, radial_grad_gen_fill, radial_grad_signature);
 
         return VG_LITE_SUCCESS;
     }
@@ -1793,6 +2573,8 @@ Empty_sequence_handler:
     {
         vg_lite_uint32_t i;
 
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
         grad->count = 0; /* Opaque B&W gradient */
         if(!count || count > VLC_MAX_GRADIENT_STOPS || colors == NULL || stops == NULL)
             return VG_LITE_SUCCESS;
@@ -1817,14 +2599,10 @@ Empty_sequence_handler:
 
     vg_lite_error_t vg_lite_update_grad(vg_lite_linear_gradient_t * grad)
     {
+        auto ctx = vg_lite_ctx::get_instance();
         vg_lite_error_t error = VG_LITE_SUCCESS;
-        int32_t r0, g0, b0, a0;
-        int32_t r1, g1, b1, a1;
-        int32_t lr, lg, lb, la;
+        vg_lite_ramp_stop_t stops[VLC_MAX_GRADIENT_STOPS];
         vg_lite_uint32_t i;
-        int32_t j;
-        int32_t ds, dr, dg, db, da;
-        vg_lite_uint32_t * buffer = (vg_lite_uint32_t *)grad->image.memory;
 
         if(grad->count == 0) {
             /* If no valid stops have been specified (e.g., due to an empty input
@@ -1837,52 +2615,27 @@ Empty_sequence_handler:
             grad->colors[1] = 0xFFFFFFFF; /* Opaque white */
             grad->count = 2;
         }
-        else if(grad->count && grad->stops[0] != 0) {
-            /* If at least one valid stop has been specified, but none has been
-             * defined with an offset of 0, an implicit stop is added with an
-             * offset of 0 and the same color as the first user-defined stop. */
-            for(i = 0; i < grad->stops[0]; i++)
-                buffer[i] = grad->colors[0];
-        }
-        a0 = A(grad->colors[0]);
-        r0 = R(grad->colors[0]);
-        g0 = G(grad->colors[0]);
-        b0 = B(grad->colors[0]);
-
-        /* Calculate the colors for each pixel of the image. */
-        for(i = 0; i < grad->count - 1; i++) {
-            buffer[grad->stops[i]] = grad->colors[i];
-            ds = grad->stops[i + 1] - grad->stops[i];
-            a1 = A(grad->colors[i + 1]);
-            r1 = R(grad->colors[i + 1]);
-            g1 = G(grad->colors[i + 1]);
-            b1 = B(grad->colors[i + 1]);
-
-            da = a1 - a0;
-            dr = r1 - r0;
-            dg = g1 - g0;
-            db = b1 - b0;
-
-            for(j = 1; j < ds; j++) {
-                la = a0 + da * j / ds;
-                lr = r0 + dr * j / ds;
-                lg = g0 + dg * j / ds;
-                lb = b0 + db * j / ds;
-
-                buffer[grad->stops[i] + j] = ARGB(la, lr, lg, lb);
-            }
-
-            a0 = a1;
-            r0 = r1;
-            g0 = g1;
-            b0 = b1;
-        }
-
-        /* If at least one valid stop has been specified, but none has been defined
-         * with an offset of 255, an implicit stop is added with an offset of 255
-         * and the same color as the last user-defined stop. */
-        for(i = grad->stops[grad->count - 1]; i < VLC_GRADIENT_BUFFER_WIDTH; i++)
-            buffer[i] = grad->colors[grad->count - 1];
+
+        /* The stops are in texels. If none is defined with an offset of 0 or
+         * 255, implicit stops with the color of the first and the last
+         * user-defined stops extend the ramp to its ends. */
+        for(i = 0; i < grad->count; i++) {
+            stops[i].pos = (vg_lite_float_t)grad->stops[i];
+            stops[i].color = grad->colors[i];
+        }
+
+        ramp_update(ctx, &grad->image, stops, grad->count, VLC_GRADIENT_BUFFER_WIDTH);
+
+        vg_lite_fill_cache_t * cache = fill_cache_update(ctx, grad, grad_gen_fill, grad_signature);
+        if(cache) {
+            /* premultiplied for the built-in rasterizer */
+            const vg_lite_uint32_t * texels = (const vg_lite_uint32_t *)grad->image.memory;
+            cache->ramp.resize(VLC_GRADIENT_BUFFER_WIDTH);
+            for(i = 0; i < VLC_GRADIENT_BUFFER_WIDTH; i++) {
+                vg_lite_uint32_t alpha = A(texels[i]);
+                cache->ramp[i] = (pixel_scale(texels[i], alpha) & 0x00ffffff) | (alpha << 24);
+            }
+        }
 
         return error;
     }
@@ -1892,6 +2645,8 @@ Empty_sequence_handler:
         vg_lite_error_t error = VG_LITE_SUCCESS;
 
         grad->count = 0;
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
         /* Release the image resource. */
         if(grad->image.handle != NULL) {
             error = vg_lite_free(&grad->image);
@@ -1905,6 +2660,8 @@ Empty_sequence_handler:
         vg_lite_error_t error = VG_LITE_SUCCESS;
 
         grad->count = 0;
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
         /* Release the image resource. */
         if(grad->image.handle != NULL) {
             error = vg_lite_free(&grad->image);
@@ -1918,6 +2675,8 @@ Empty_sequence_handler:
         vg_lite_error_t error = VG_LITE_SUCCESS;
 
         grad->count = 0;
+        fill_cache_drop(vg_lite_ctx::get_instance(), grad);
+
         /* Release the image resource. */
         if(grad->image.handle != NULL) {
             error = vg_lite_free(&grad->image);
@@ -1949,51 +2708,33 @@ Empty_sequence_handler:
                                       vg_lite_blend_t blend)
     {
         auto ctx = vg_lite_ctx::get_instance();
+
+        if(path_is_culled(ctx, target, path, matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+        /* rectangles and the LOW and MEDIUM quality fills are shaded from the integer ramp */
+        Result raster_res = raster_draw_grad(ctx, target, path, fill_rule, matrix, grad, blend);
+        if(raster_res != Result::NonSupport) {
+            TVG_CHECK_RETURN_VG_ERROR(raster_res);
+            return VG_LITE_SUCCESS;
+        }
+
         auto shape = Shape::gen();
-        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix));
+        vg_lite_fbox_t bounds;
+        vg_lite_fbox_t extent;
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix, &bounds, &extent));
         TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
-        TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
-
-        vg_lite_matrix_t grad_matrix;
-        TVG_CHECK_RETURN_VG_ERROR(vg_lite_grad_matrix_conv(&grad_matrix, &grad->matrix, matrix));
-
-        vg_lite_fpoint_t p1 = {0.0f, 0.0f};
-        vg_lite_fpoint_t p2 = {1.0f, 0};
-
-        vg_lite_fpoint_t p1_trans = p1;
-        vg_lite_fpoint_t p2_trans = p2;
-
-        p1_trans = matrix_transform_point(&grad_matrix, &p1);
-        p2_trans = matrix_transform_point(&grad_matrix, &p2);
-        float dx = (p2_trans.x - p1_trans.x);
-        float dy = (p2_trans.y - p1_trans.y);
-        float scale = sqrtf(dx * dx + dy * dy);
-        float angle = (float)(atan2f(dy, dx));
-        float dlen = 256 * scale;
-        float x_min = grad_matrix.m[0][2];
-        float y_min = grad_matrix.m[1][2];
-        float x_max = x_min + dlen * cosf(angle);
-        float y_max = y_min + dlen * sinf(angle);
-        LV_LOG_TRACE("linear gradient {%.2f, %.2f} ~ {%.2f, %.2f}", x_min, y_min, x_max, y_max);
-        auto linearGrad = LinearGradient::gen();
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->linear(x_min, y_min, x_max, y_max));
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->spread(FillSpread::Pad));
-
-        tvg::Fill::ColorStop colorStops[VLC_MAX_GRADIENT_STOPS];
-        for(vg_lite_uint32_t i = 0; i < grad->count; i++) {
-            colorStops[i].offset = grad->stops[i] / 255.0f;
-            colorStops[i].r = R(grad->colors[i]);
-            colorStops[i].g = G(grad->colors[i]);
-            colorStops[i].b = B(grad->colors[i]);
-            colorStops[i].a = A(grad->colors[i]);
-        }
-        TVG_CHECK_RETURN_VG_ERROR(linearGrad->colorStops(colorStops, grad->count));
+
+        std::unique_ptr<Fill> linearGrad;
+        TVG_CHECK_RETURN_VG_ERROR(fill_cache_get(ctx, linearGrad, grad, &grad->matrix, matrix, grad_gen_fill,
+                                                 grad_signature, grad_set_matrix));
 
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(std::move(linearGrad)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(shape), blend, &bounds, &extent));
 
         return VG_LITE_SUCCESS;
     }
@@ -2011,34 +2752,26 @@ Empty_sequence_handler:
         LV_UNUSED(filter);
 
         auto ctx = vg_lite_ctx::get_instance();
+
+        if(path_is_culled(ctx, target, path, path_matrix)) {
+            return VG_LITE_SUCCESS;
+        }
+
         TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
         auto shape = Shape::gen();
-        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix));
+        vg_lite_fbox_t bounds;
+        vg_lite_fbox_t extent;
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix, &bounds, &extent));
         TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(path_matrix)));
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
-        TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
-
-        vg_lite_matrix_t grad_matrix;
-        TVG_CHECK_RETURN_VG_ERROR(vg_lite_grad_matrix_conv(&grad_matrix, &grad->matrix, path_matrix));
-
-        auto radialGrad = RadialGradient::gen();
-        TVG_CHECK_RETURN_VG_ERROR(radialGrad->transform(matrix_conv(&grad_matrix)));
-        TVG_CHECK_RETURN_VG_ERROR(radialGrad->radial(grad->radial_grad.cx, grad->radial_grad.cy, grad->radial_grad.r));
-        TVG_CHECK_RETURN_VG_ERROR(radialGrad->spread(fill_spread_conv(grad->spread_mode)));
 
-        tvg::Fill::ColorStop colorStops[VLC_MAX_COLOR_RAMP_STOPS];
-        for(vg_lite_uint32_t i = 0; i < grad->ramp_length; i++) {
-            colorStops[i].offset = grad->color_ramp[i].stop;
-            colorStops[i].r = grad->color_ramp[i].red * 255.0f;
-            colorStops[i].g = grad->color_ramp[i].green * 255.0f;
-            colorStops[i].b = grad->color_ramp[i].blue * 255.0f;
-            colorStops[i].a = grad->color_ramp[i].alpha * 255.0f;
-        }
-        TVG_CHECK_RETURN_VG_ERROR(radialGrad->colorStops(colorStops, grad->ramp_length));
+        std::unique_ptr<Fill> radialGrad;
+        TVG_CHECK_RETURN_VG_ERROR(fill_cache_get(ctx, radialGrad, grad, &grad->matrix, path_matrix,
+                                                 radial_grad_gen_fill, radial_grad_signature, radial_grad_set_matrix));
 
         TVG_CHECK_RETURN_VG_ERROR(shape->fill(std::move(radialGrad)));
-        TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas_push(ctx, target, std::move(shape), blend, &bounds, &extent));
 
         return VG_LITE_SUCCESS;
     }
@@ -2059,118 +2792,358 @@ Empty_sequence_handler:
             return VG_LITE_INVALID_ARGUMENT;
         }
 
-        if(ctx->scissor_rect.x == x && ctx->scissor_rect.y == y &&
-           ctx->scissor_rect.width == width && ctx->scissor_rect.height == height) {
-            return VG_LITE_SUCCESS;
+        /* the pending commands keep the scissor they were issued with */
+        vg_lite_rectangle_t rect = { x, y, width, height };
+        ctx->scissor_rects.assign(1, rect);
+        ctx->scissor_clip_all = false;
+        ctx->scissor_enabled = true;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_scissor_rects(vg_lite_uint32_t nums, vg_lite_rectangle_t rect[])
+    {
+        auto ctx = vg_lite_ctx::get_instance();
+
+        if(!nums || !rect) {
+            return VG_LITE_INVALID_ARGUMENT;
         }
 
-        /*Finish the previous rendering before setting the new scissor*/
-        vg_lite_error_t error;
-        VG_LITE_RETURN_ERROR(vg_lite_finish());
+        /* the pixels inside any of the rects are drawn, the empty rects clip everything out */
+        ctx->scissor_rects.clear();
+        for(vg_lite_uint32_t i = 0; i < nums; i++) {
+            if(rect[i].width > 0 && rect[i].height > 0) {
+                ctx->scissor_rects.push_back(rect[i]);
+            }
+        }
+
+        ctx->scissor_clip_all = ctx->scissor_rects.empty();
 
-        ctx->scissor_rect.x = x;
-        ctx->scissor_rect.y = y;
-        ctx->scissor_rect.width = width;
-        ctx->scissor_rect.height = height;
-        ctx->scissor_is_set = true;
         return VG_LITE_SUCCESS;
     }
 
     vg_lite_error_t vg_lite_enable_scissor(void)
     {
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->scissor_enabled = true;
         return VG_LITE_SUCCESS;
     }
 
     vg_lite_error_t vg_lite_disable_scissor(void)
     {
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->scissor_enabled = false;
         return VG_LITE_SUCCESS;
     }
 
     vg_lite_error_t vg_lite_gaussian_filter(vg_lite_float_t w0, vg_lite_float_t w1, vg_lite_float_t w2)
     {
-        LV_UNUSED(w0);
-        LV_UNUSED(w1);
-        LV_UNUSED(w2);
-        return VG_LITE_NOT_SUPPORT;
-    }
+        auto ctx = vg_lite_ctx::get_instance();
 
-    vg_lite_error_t vg_lite_get_mem_size(vg_lite_uint32_t * size)
-    {
-        *size = 0;
+        vg_lite_float_t sum = w0 + 4 * w1 + 4 * w2;
+        if(w0 < 0 || w1 < 0 || w2 < 0 || sum <= 0) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* normalized to 256, the center takes the rounding error so the kernel never overflows */
+        vg_lite_uint32_t side = (vg_lite_uint32_t)(w1 * 256 / sum + 0.5f);
+        vg_lite_uint32_t corner = (vg_lite_uint32_t)(w2 * 256 / sum + 0.5f);
+        while(4 * (side + corner) > 256) {
+            side > corner ? side-- : corner--;
+        }
+
+        ctx->gaussian_weights[0] = 256 - 4 * (side + corner);
+        ctx->gaussian_weights[1] = side;
+        ctx->gaussian_weights[2] = corner;
         return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_source_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+    vg_lite_error_t vg_lite_enable_masklayer(void)
     {
-        LV_UNUSED(alpha_mode);
-        LV_UNUSED(alpha_value);
-        return VG_LITE_NOT_SUPPORT;
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->mask_enabled = true;
+        mask_update(ctx);
+        return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_dest_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+    vg_lite_error_t vg_lite_disable_masklayer(void)
     {
-        LV_UNUSED(alpha_mode);
-        LV_UNUSED(alpha_value);
-        return VG_LITE_NOT_SUPPORT;
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->mask_enabled = false;
+        mask_update(ctx);
+        return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_set_color_key(vg_lite_color_key4_t colorkey)
+    vg_lite_error_t vg_lite_set_masklayer(vg_lite_buffer_t * masklayer)
     {
-        LV_UNUSED(colorkey);
-        return VG_LITE_NOT_SUPPORT;
-    }
+        auto ctx = vg_lite_ctx::get_instance();
 
-    vg_lite_error_t vg_lite_set_flexa_stream_id(uint8_t stream_id)
-    {
-        LV_UNUSED(stream_id);
-        return VG_LITE_NOT_SUPPORT;
-    }
+        if(!masklayer || !masklayer->memory || masklayer->format != VG_LITE_A8) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
 
-    vg_lite_error_t vg_lite_set_flexa_current_background_buffer(uint8_t stream_id,
-                                                                vg_lite_buffer_t * buffer,
-                                                                vg_lite_uint32_t background_segment_count,
-                                                                vg_lite_uint32_t background_segment_size)
-    {
-        LV_UNUSED(stream_id);
-        LV_UNUSED(buffer);
-        LV_UNUSED(background_segment_count);
-        LV_UNUSED(background_segment_size);
-        return VG_LITE_NOT_SUPPORT;
+        ctx->masklayer = masklayer;
+        mask_update(ctx);
+        return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_enable_flexa(void)
+    vg_lite_error_t vg_lite_destroy_masklayer(vg_lite_buffer_t * masklayer)
     {
-        return VG_LITE_NOT_SUPPORT;
-    }
+        if(!masklayer || !masklayer->memory) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
 
-    vg_lite_error_t vg_lite_disable_flexa(void)
-    {
-        return VG_LITE_NOT_SUPPORT;
+        /* vg_lite_free() unbinds it when it is the active mask */
+        return vg_lite_free(masklayer);
     }
 
-    vg_lite_error_t vg_lite_set_flexa_stop_frame(void)
+    vg_lite_error_t vg_lite_create_masklayer(vg_lite_buffer_t * masklayer, vg_lite_uint32_t width,
+                                             vg_lite_uint32_t height)
     {
-        return VG_LITE_NOT_SUPPORT;
-    }
+        if(!masklayer || !width || !height) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
 
-    vg_lite_error_t vg_lite_enable_dither(void)
-    {
-        return VG_LITE_NOT_SUPPORT;
+        vg_lite_error_t error;
+        memset(masklayer, 0, sizeof(vg_lite_buffer_t));
+        masklayer->width = width;
+        masklayer->height = height;
+        masklayer->format = VG_LITE_A8;
+        VG_LITE_RETURN_ERROR(vg_lite_allocate(masklayer));
+
+        /* everything is visible through a new mask */
+        memset(masklayer->memory, 0xFF, masklayer->stride * height);
+        return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_disable_dither(void)
+    vg_lite_error_t vg_lite_fill_masklayer(vg_lite_buffer_t * masklayer, vg_lite_rectangle_t * rect,
+                                           vg_lite_uint8_t value)
     {
-        return VG_LITE_NOT_SUPPORT;
-    }
+        if(!masklayer || !masklayer->memory || !rect) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
 
-    vg_lite_error_t vg_lite_set_tess_buffer(vg_lite_uint32_t physical, vg_lite_uint32_t size)
-    {
-        LV_UNUSED(physical);
-        LV_UNUSED(size);
-        return VG_LITE_NOT_SUPPORT;
+        int32_t x_min = MAX(rect->x, 0);
+        int32_t y_min = MAX(rect->y, 0);
+        int32_t x_max = MIN(rect->x + rect->width, (int32_t)masklayer->width);
+        int32_t y_max = MIN(rect->y + rect->height, (int32_t)masklayer->height);
+
+        for(int32_t y = y_min; y < y_max && x_min < x_max; y++) {
+            memset((uint8_t *)masklayer->memory + y * masklayer->stride + x_min, value, x_max - x_min);
+        }
+
+        return VG_LITE_SUCCESS;
     }
 
-    vg_lite_error_t vg_lite_set_command_buffer(vg_lite_uint32_t physical, vg_lite_uint32_t size)
+    vg_lite_error_t vg_lite_blend_masklayer(vg_lite_buffer_t * dst, vg_lite_buffer_t * src,
+                                            vg_lite_mask_operation_t operation, vg_lite_rectangle_t * rect)
+    {
+        if(!dst || !dst->memory || !src || !src->memory || !rect) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        if(operation < VG_LITE_CLEAR_MASK || operation > VG_LITE_SUBTRACT_MASK) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* both masks share the coordinates of the rect */
+        int32_t x_min = MAX(rect->x, 0);
+        int32_t y_min = MAX(rect->y, 0);
+        int32_t x_max = MIN(rect->x + rect->width, (int32_t)MIN(dst->width, src->width));
+        int32_t y_max = MIN(rect->y + rect->height, (int32_t)MIN(dst->height, src->height));
+
+        for(int32_t y = y_min; y < y_max && x_min < x_max; y++) {
+            mask_blend_row((uint8_t *)dst->memory + y * dst->stride + x_min,
+                           (const uint8_t *)src->memory + y * src->stride + x_min, x_max - x_min, operation);
+        }
+
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_render_masklayer(vg_lite_buffer_t * masklayer, vg_lite_mask_operation_t operation,
+                                             vg_lite_path_t * path, vg_lite_fill_t fill_rule, vg_lite_color_t color,
+                                             vg_lite_matrix_t * matrix)
+    {
+        if(!masklayer || !masklayer->memory || !path) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        if(operation < VG_LITE_CLEAR_MASK || operation > VG_LITE_SUBTRACT_MASK) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        return mask_render_path(vg_lite_ctx::get_instance(), masklayer, operation, path, fill_rule, color, matrix);
+    }
+
+    vg_lite_error_t vg_lite_get_mem_size(vg_lite_uint32_t * size)
+    {
+        /* the bytes of the allocated buffers, gpu_get_mem_peak() gives the most there has been */
+        *size = (vg_lite_uint32_t)vg_lite_ctx::get_instance()->pool.live_size;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_source_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+    {
+        if(alpha_mode != VG_LITE_NORMAL && alpha_mode != VG_LITE_GLOBAL && alpha_mode != VG_LITE_SCALED) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* applied by the image fetches and the decode, alongside the premultiplication */
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->raster.src_alpha_mode = alpha_mode;
+        ctx->raster.src_alpha_value = alpha_value;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_dest_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+    {
+        if(alpha_mode != VG_LITE_NORMAL && alpha_mode != VG_LITE_GLOBAL && alpha_mode != VG_LITE_SCALED) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* applied by the compositor to the target it reads, the target keeps its own alpha */
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->raster.dest_alpha_mode = alpha_mode;
+        ctx->raster.dest_alpha_value = alpha_value;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_color_key(vg_lite_color_key4_t colorkey)
+    {
+        /* applied by the decode of the images, the sources are never modified */
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->color_key_enabled = false;
+
+        for(int i = 0; i < 4; i++) {
+            if(colorkey[i].enable) {
+                ctx->color_keys[i] = colorkey[i];
+                ctx->color_key_enabled = true;
+            }
+            else {
+                memset(&ctx->color_keys[i], 0, sizeof(ctx->color_keys[i]));
+            }
+        }
+
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_pixel_matrix(vg_lite_pixel_matrix_t matrix, vg_lite_pixel_channel_enable_t * channel)
+    {
+        if(!matrix || !channel) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+        memcpy(ctx->pixel_matrix, matrix, sizeof(ctx->pixel_matrix));
+        ctx->pixel_matrix_channels = *channel;
+        color_stage_update(ctx);
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_mirror(vg_lite_orientation_t orientation)
+    {
+        if(orientation != VG_LITE_ORIENTATION_TOP_BOTTOM && orientation != VG_LITE_ORIENTATION_BOTTOM_TOP) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* applied to the matrices of the blits, a mirrored whole pixel blit reads the source rows backwards */
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->mirror = orientation;
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_gamma(vg_lite_gamma_conversion_t gamma_value)
+    {
+        if(gamma_value != VG_LITE_GAMMA_NO_CONVERSION && gamma_value != VG_LITE_GAMMA_LINEAR
+           && gamma_value != VG_LITE_GAMMA_NON_LINEAR) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->gamma_conversion = gamma_value;
+        color_stage_update(ctx);
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_enable_color_transform(void)
+    {
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->color_transform_enabled = true;
+        color_stage_update(ctx);
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_disable_color_transform(void)
+    {
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->color_transform_enabled = false;
+        color_stage_update(ctx);
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_color_transform(vg_lite_color_transform_t * values)
+    {
+        if(!values) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* the scales multiply the 0 ~ 1 channels, the biases are added after */
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->color_transform = *values;
+        color_stage_update(ctx);
+        return VG_LITE_SUCCESS;
+    }
+
+    vg_lite_error_t vg_lite_set_flexa_stream_id(uint8_t stream_id)
+    {
+        LV_UNUSED(stream_id);
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_set_flexa_current_background_buffer(uint8_t stream_id,
+                                                                vg_lite_buffer_t * buffer,
+                                                                vg_lite_uint32_t background_segment_count,
+                                                                vg_lite_uint32_t background_segment_size)
+    {
+        LV_UNUSED(stream_id);
+        LV_UNUSED(buffer);
+        LV_UNUSED(background_segment_count);
+        LV_UNUSED(background_segment_size);
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_enable_flexa(void)
+    {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_disable_flexa(void)
+    {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_set_flexa_stop_frame(void)
+    {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_enable_dither(void)
+    {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_disable_dither(void)
+    {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_set_tess_buffer(vg_lite_uint32_t physical, vg_lite_uint32_t size)
+    {
+        LV_UNUSED(physical);
+        LV_UNUSED(size);
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_error_t vg_lite_set_command_buffer(vg_lite_uint32_t physical, vg_lite_uint32_t size)
     {
         LV_UNUSED(physical);
         LV_UNUSED(size);
@@ -2248,6 +3221,57 @@ static Matrix matrix_conv(const vg_lite_matrix_t * matrix)
     return *(Matrix *)matrix;
 }
 
+static vg_lite_matrix_class_t matrix_classify(const vg_lite_matrix_t * matrix)
+{
+    /**
+     * The callers write the entries directly, a class cached in the matrix could go stale.
+     * Classifying takes a few compares, it is done once per command.
+     */
+    if(!matrix) {
+        return MATRIX_CLASS_IDENTITY;
+    }
+
+    if(matrix_has_perspective(matrix)) {
+        return MATRIX_CLASS_PERSPECTIVE;
+    }
+
+    if(math_zero(matrix->m[0][1]) && math_zero(matrix->m[1][0])) {
+        if(!math_equal(matrix->m[0][0], 1.0f) || !math_equal(matrix->m[1][1], 1.0f)) {
+            return MATRIX_CLASS_SCALE;
+        }
+
+        return math_zero(matrix->m[0][2]) && math_zero(matrix->m[1][2]) ? MATRIX_CLASS_IDENTITY : MATRIX_CLASS_TRANSLATE;
+    }
+
+    if(math_zero(matrix->m[0][0]) && math_zero(matrix->m[1][1])) {
+        return MATRIX_CLASS_AXIS_ALIGNED;
+    }
+
+    return MATRIX_CLASS_AFFINE;
+}
+
+static bool matrix_is_axis_aligned(const vg_lite_matrix_t * matrix)
+{
+    return matrix_classify(matrix) <= MATRIX_CLASS_AXIS_ALIGNED;
+}
+
+static bool matrix_has_perspective(const vg_lite_matrix_t * matrix)
+{
+    return matrix && (!math_zero(matrix->m[2][0]) || !math_zero(matrix->m[2][1]) || !math_equal(matrix->m[2][2], 1.0f));
+}
+
+static vg_lite_float_t matrix_get_scale(const vg_lite_matrix_t * matrix)
+{
+    if(!matrix) {
+        return 1.0f;
+    }
+
+    /* the largest stretch of the unit vectors, anisotropic scales are not under-sampled */
+    vg_lite_float_t sx = point_length(matrix->m[0][0], matrix->m[1][0]);
+    vg_lite_float_t sy = point_length(matrix->m[0][1], matrix->m[1][1]);
+    return MAX(sx, sy);
+}
+
 static FillRule fill_rule_conv(vg_lite_fill_t fill)
 {
     if(fill == VG_LITE_FILL_EVEN_ODD) {
@@ -2259,20 +3283,18 @@ static FillRule fill_rule_conv(vg_lite_fill_t fill)
 
 static BlendMethod blend_method_conv(vg_lite_blend_t blend)
 {
+    /* the modes without an equivalent are rendered as Normal and composited by canvas_push() */
     switch(blend) {
         case VG_LITE_BLEND_NONE:
+        case OPENVG_BLEND_SRC:
             return BlendMethod::SrcOver;
 
-        case VG_LITE_BLEND_NORMAL_LVGL:
-            return BlendMethod::Normal;
-
-        case VG_LITE_BLEND_SRC_OVER:
-            return BlendMethod::Normal;
-
         case VG_LITE_BLEND_SCREEN:
+        case OPENVG_BLEND_SCREEN:
             return BlendMethod::Screen;
 
         case VG_LITE_BLEND_ADDITIVE:
+        case OPENVG_BLEND_ADDITIVE:
             return BlendMethod::Add;
 
         case VG_LITE_BLEND_MULTIPLY:
@@ -2285,6 +3307,12 @@ static BlendMethod blend_method_conv(vg_lite_blend_t blend)
     return BlendMethod::Normal;
 }
 
+static bool blend_is_native(vg_lite_blend_t blend)
+{
+    /* thorvg blends these the way vg_lite.h defines them */
+    return blend_is_source_over(blend) || blend_method_conv(blend) != BlendMethod::Normal;
+}
+
 static StrokeCap stroke_cap_conv(vg_lite_cap_style_t cap)
 {
     switch(cap) {
@@ -2436,7 +3464,8 @@ static Result shape_set_stroke(std::unique_ptr<Shape> & shape, const vg_lite_pat
     return Result::Success;
 }
 
-static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t * path, vg_lite_matrix_t * matrix)
+static Result shape_append_curves(std::unique_ptr<Shape> & shape, const vg_lite_path_t * path,
+                                  vg_lite_fbox_t * extents)
 {
     uint8_t fmt_len = vlc_format_len(path->format);
     uint8_t * cur = (uint8_t *)path->path;
@@ -2456,6 +3485,7 @@ static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t *
             case VLC_OP_MOVE: {
                     float x = VLC_GET_ARG(cur, 0);
                     float y = VLC_GET_ARG(cur, 1);
+                    fbox_add_point(extents, x, y);
                     TVG_CHECK_RETURN_RESULT(shape->moveTo(x, y));
                 }
                 break;
@@ -2463,6 +3493,7 @@ static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t *
             case VLC_OP_LINE: {
                     float x = VLC_GET_ARG(cur, 0);
                     float y = VLC_GET_ARG(cur, 1);
+                    fbox_add_point(extents, x, y);
                     TVG_CHECK_RETURN_RESULT(shape->lineTo(x, y));
                 }
                 break;
@@ -2475,6 +3506,8 @@ static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t *
                     float qcy1 = VLC_GET_ARG(cur, 1);
                     float x = VLC_GET_ARG(cur, 2);
                     float y = VLC_GET_ARG(cur, 3);
+                    fbox_add_point(extents, qcx1, qcy1);
+                    fbox_add_point(extents, x, y);
 
                     qcx0 += (qcx1 - qcx0) * 2 / 3;
                     qcy0 += (qcy1 - qcy0) * 2 / 3;
@@ -2492,6 +3525,9 @@ static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t *
                     float cy2 = VLC_GET_ARG(cur, 3);
                     float x = VLC_GET_ARG(cur, 4);
                     float y = VLC_GET_ARG(cur, 5);
+                    fbox_add_point(extents, cx1, cy1);
+                    fbox_add_point(extents, cx2, cy2);
+                    fbox_add_point(extents, x, y);
                     TVG_CHECK_RETURN_RESULT(shape->cubicTo(cx1, cy1, cx2, cy2, x, y));
                 }
                 break;
@@ -2507,22 +3543,131 @@ static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t *
         cur += arg_len * fmt_len;
     }
 
+    return Result::Success;
+}
+
+static Result shape_append_path(std::unique_ptr<Shape> & shape, vg_lite_path_t * path, vg_lite_matrix_t * matrix,
+                                vg_lite_fbox_t * bounds, vg_lite_fbox_t * extent)
+{
+    /**
+     * 'bounds' receives the bounding box clip in target space when it is a rectangle there,
+     * canvas_push() merges it with the scissor. It is left unbounded otherwise.
+     * 'extent' receives the target area the path can cover at most.
+     */
+    *bounds = { -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX };
+    *extent = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    /* Hull of all the points (control points included), it always encloses the path */
+    vg_lite_fbox_t extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+#if LV_VG_LITE_THORVG_QUALITY_TIERS
+    /* HIGH and UPPER keep the curves, thorvg flattens them at full precision */
+    bool simplified = path->quality == VG_LITE_MEDIUM || path->quality == VG_LITE_LOW;
+#else
+    bool simplified = false;
+#endif
+
+    if(!simplified || matrix_has_perspective(matrix)) {
+        /* full precision, or a scale varying across the path: keep the curves */
+        TVG_CHECK_RETURN_RESULT(shape_append_curves(shape, path, &extents));
+    }
+    else {
+        const vg_lite_lod_t * lod = path_get_lod(vg_lite_ctx::get_instance(), path, matrix);
+        if(!lod->cmds.empty()) {
+            TVG_CHECK_RETURN_RESULT(shape->appendPath(lod->cmds.data(), (uint32_t)lod->cmds.size(),
+                                                      lod->pts.data(), (uint32_t)lod->pts.size()));
+        }
+
+        extents = lod->polygon.path_extents;
+    }
+
     TVG_CHECK_RETURN_RESULT(shape_set_stroke(shape, path));
 
-    float x_min = path->bounding_box[0];
-    float y_min = path->bounding_box[1];
-    float x_max = path->bounding_box[2];
-    float y_max = path->bounding_box[3];
+    vg_lite_fbox_t bbox = {
+        path->bounding_box[0],
+        path->bounding_box[1],
+        path->bounding_box[2],
+        path->bounding_box[3]
+    };
+
+    if(fbox_is_empty(&extents)) {
+        return Result::Success;
+    }
+
+    if(path->path_type & VG_LITE_DRAW_STROKE_PATH) {
+        /* widest possible outline: miter joins and the corners of square caps */
+        float expand = path->stroke->half_width;
+        if(path->stroke->join_style == VG_LITE_JOIN_MITER) {
+            expand *= MAX(path->stroke->miter_limit, MATH_SQRT2);
+        }
+        else {
+            expand *= MATH_SQRT2;
+        }
+
+        extents.x_min -= expand;
+        extents.y_min -= expand;
+        extents.x_max += expand;
+        extents.y_max += expand;
+    }
+
+    bool unbounded = math_equal(bbox.x_min, -FLT_MAX) && math_equal(bbox.y_min, -FLT_MAX)
+                     && math_equal(bbox.x_max, FLT_MAX) && math_equal(bbox.y_max, FLT_MAX);
+
+    vg_lite_fbox_t covered = extents;
+    if(!unbounded) {
+        covered.x_min = MAX(covered.x_min, bbox.x_min);
+        covered.y_min = MAX(covered.y_min, bbox.y_min);
+        covered.x_max = MIN(covered.x_max, bbox.x_max);
+        covered.y_max = MIN(covered.y_max, bbox.y_max);
+    }
+
+    if(!fbox_is_empty(&covered)) {
+        if(matrix) {
+            /* crossing the horizon of a projection, it comes back unbounded */
+            vg_lite_matrix_transform_bbox(matrix, &covered.x_min, &extent->x_min, 1);
+        }
+        else {
+            *extent = covered;
+        }
+    }
+
+    if(unbounded) {
+        return Result::Success;
+    }
+
+    /* The bounding box and the path share the same coordinate space, no transformation required */
+    if(fbox_contains(&bbox, &extents)) {
+        /* the clip can't cut anything away */
+        return Result::Success;
+    }
+
+    if(!fbox_intersects(&bbox, &extents)) {
+        /* nothing survives the clip, drop the path but keep the paint setup */
+        return shape->reset();
+    }
+
+    if(matrix_is_axis_aligned(matrix)) {
+        /**
+         * A rectangle in device space: it is intersected with the scissor rectangle attached by
+         * canvas_push(), the paint keeps a single untransformed clip rectangle that thorvg resolves
+         * as a region intersection of the spans, without a mask composition.
+         */
+        vg_lite_fpoint_t p0 = { bbox.x_min, bbox.y_min };
+        vg_lite_fpoint_t p1 = { bbox.x_max, bbox.y_max };
+        if(matrix) {
+            p0 = matrix_transform_point(matrix, &p0);
+            p1 = matrix_transform_point(matrix, &p1);
+        }
 
-    if(math_equal(x_min, -FLT_MAX) && math_equal(y_min, -FLT_MAX)
-       && math_equal(x_max, FLT_MAX) && math_equal(y_max, FLT_MAX)) {
+        *bounds = { MIN(p0.x, p1.x), MIN(p0.y, p1.y), MAX(p0.x, p1.x), MAX(p0.y, p1.y) };
         return Result::Success;
     }
 
-    auto cilp = Shape::gen();
-    TVG_CHECK_RETURN_RESULT(cilp->appendRect(x_min, y_min, x_max - x_min, y_max - y_min, 0, 0));
-    TVG_CHECK_RETURN_RESULT(cilp->transform(matrix_conv(matrix)));
-    TVG_CHECK_RETURN_RESULT(shape->composite(std::move(cilp), CompositeMethod::ClipPath));
+    /* rotated or skewed, a composite mask is required */
+    auto clip = Shape::gen();
+    TVG_CHECK_RETURN_RESULT(clip->appendRect(bbox.x_min, bbox.y_min, bbox.x_max - bbox.x_min, bbox.y_max - bbox.y_min, 0, 0));
+    TVG_CHECK_RETURN_RESULT(clip->transform(matrix_conv(matrix)));
+    TVG_CHECK_RETURN_RESULT(shape->composite(std::move(clip), CompositeMethod::ClipPath));
 
     return Result::Success;
 }
@@ -2553,6 +3698,10 @@ static Result canvas_set_target(vg_lite_ctx * ctx, vg_lite_buffer_t * target)
     ctx->target_buffer = target->memory;
     ctx->target_format = target->format;
     ctx->target_px_size = target->width * target->height;
+    mapping_begin(ctx, target);
+
+    /* the target is about to be drawn, the mipmaps made from it are stale */
+    mip_cache_drop(ctx, target);
 
     void * canvas_target_buffer;
     uint32_t stride = 0;
@@ -2572,6 +3721,8 @@ static Result canvas_set_target(vg_lite_ctx * ctx, vg_lite_buffer_t * target)
         stride = target->width;
     }
 
+    ctx->tvg_target_stride = stride;
+
     /* Prevent repeated target setting */
     if(ctx->tvg_target_buffer == canvas_target_buffer) {
         return Result::Success;
@@ -2586,212 +3737,4091 @@ static Result canvas_set_target(vg_lite_ctx * ctx, vg_lite_buffer_t * target)
                                 target->height,
                                 SwCanvas::ARGB8888));
 
-    if(ctx->scissor_is_set) {
-        TVG_CHECK_RETURN_RESULT(
-            ctx->canvas->viewport(
-                ctx->scissor_rect.x, ctx->scissor_rect.y,
-                ctx->scissor_rect.width, ctx->scissor_rect.height));
-    }
-
     return Result::Success;
 }
 
-static bool decode_indexed_line(
-    vg_lite_buffer_format_t color_format,
-    const vg_lite_uint32_t * palette,
-    int32_t x, int32_t y,
-    int32_t w_px, uint32_t stride, const uint8_t * in, vg_lite_uint32_t * out)
+static bool scissor_get_clip(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, vg_lite_ibox_t * clip)
 {
-    uint8_t px_size;
-    uint16_t mask;
+    /**
+     * Intersects the target area with the enabled scissor rects.
+     * Returns false when they are several, 'clip' is then only their bounding box.
+     */
+    *clip = { 0, 0, (int32_t)target->width, (int32_t)target->height };
 
-    in += stride * y; /*First pixel*/
-    out += w_px * y;
+    if(!ctx->scissor_enabled) {
+        return true;
+    }
 
-    int8_t shift = 0;
-    switch(color_format) {
-        case VG_LITE_INDEX_1:
-            px_size = 1;
-            in += x / 8; /*8pixel per byte*/
-            shift = 7 - (x & 0x7);
-            break;
-        case VG_LITE_INDEX_2:
-            px_size = 2;
-            in += x / 4; /*4pixel per byte*/
-            shift = 6 - 2 * (x & 0x3);
-            break;
-        case VG_LITE_INDEX_4:
-            px_size = 4;
-            in += x / 2; /*2pixel per byte*/
-            shift = 4 - 4 * (x & 0x1);
+    if(ctx->scissor_clip_all) {
+        *clip = { 0, 0, 0, 0 };
+        return true;
+    }
+
+    if(ctx->scissor_rects.empty()) {
+        return true;
+    }
+
+    vg_lite_ibox_t bounds = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    for(const auto & rect : ctx->scissor_rects) {
+        bounds.x_min = MIN(bounds.x_min, rect.x);
+        bounds.y_min = MIN(bounds.y_min, rect.y);
+        bounds.x_max = MAX(bounds.x_max, rect.x + rect.width);
+        bounds.y_max = MAX(bounds.y_max, rect.y + rect.height);
+    }
+
+    clip->x_min = MAX(clip->x_min, bounds.x_min);
+    clip->y_min = MAX(clip->y_min, bounds.y_min);
+    clip->x_max = MIN(clip->x_max, bounds.x_max);
+    clip->y_max = MIN(clip->y_max, bounds.y_max);
+
+    return ctx->scissor_rects.size() == 1;
+}
+
+static Result canvas_push(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, std::unique_ptr<Paint> paint,
+                          vg_lite_blend_t blend, const vg_lite_fbox_t * bounds, const vg_lite_fbox_t * extent,
+                          vg_lite_uint32_t alpha)
+{
+    /**
+     * The scissor is attached to each paint as a clip path instead of being the viewport of
+     * the canvas, it can then change between two paints without rendering the pending ones.
+     * 'bounds', the clip of the paint in target space, is merged into the same rectangles.
+     * An axis aligned rectangle is resolved by thorvg as a region intersection of the spans.
+     * The mask and the blend modes thorvg does not have are applied once the paint is rendered.
+     * 'extent', the target area the paint can cover when known, narrows the pending area.
+     * 'alpha', the alpha of a paint of a single color, separates its coverage for those blend modes.
+     */
+    vg_lite_ibox_t clip;
+    bool single = scissor_get_clip(ctx, target, &clip);
+    bool masked = ctx->raster.mask != nullptr;
+    bool composited = masked || !blend_is_native(blend) || ctx->raster.dest_alpha_mode != VG_LITE_NORMAL;
+    bool bounded = bounds && (bounds->x_min > clip.x_min || bounds->y_min > clip.y_min
+                              || bounds->x_max < clip.x_max || bounds->y_max < clip.y_max);
+
+    if(masked) {
+        /* the mask reads as 0 outside of its area */
+        clip.x_max = MIN(clip.x_max, ctx->raster.mask_width);
+        clip.y_max = MIN(clip.y_max, ctx->raster.mask_height);
+    }
+
+    /* the fractional edges of 'bounds' are kept in 'area', 'clip' covers its pixels */
+    vg_lite_fbox_t area = {
+        (vg_lite_float_t)clip.x_min, (vg_lite_float_t)clip.y_min,
+        (vg_lite_float_t)clip.x_max, (vg_lite_float_t)clip.y_max
+    };
+
+    if(bounded) {
+        area.x_min = MAX(area.x_min, bounds->x_min);
+        area.y_min = MAX(area.y_min, bounds->y_min);
+        area.x_max = MIN(area.x_max, bounds->x_max);
+        area.y_max = MIN(area.y_max, bounds->y_max);
+
+        if(area.x_min >= area.x_max || area.y_min >= area.y_max) {
+            return Result::Success;
+        }
+
+        clip = { (int32_t)floorf(area.x_min), (int32_t)floorf(area.y_min),
+                 (int32_t)ceilf(area.x_max), (int32_t)ceilf(area.y_max)
+               };
+    }
+
+    if(clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return Result::Success;
+    }
+
+    /* the built-in rasterizer waits for the pending paints only where they land */
+    vg_lite_ibox_t landed = clip;
+    if(extent) {
+        if(fbox_is_empty(extent)) {
+            return Result::Success;
+        }
+
+        landed.x_min = MAX(landed.x_min, (int32_t)floorf(CLAMP(extent->x_min, area.x_min, area.x_max)));
+        landed.y_min = MAX(landed.y_min, (int32_t)floorf(CLAMP(extent->y_min, area.y_min, area.y_max)));
+        landed.x_max = MIN(landed.x_max, (int32_t)ceilf(CLAMP(extent->x_max, area.x_min, area.x_max)));
+        landed.y_max = MIN(landed.y_max, (int32_t)ceilf(CLAMP(extent->y_max, area.y_min, area.y_max)));
+
+        if(landed.x_min >= landed.x_max || landed.y_min >= landed.y_max) {
+            return Result::Success;
+        }
+    }
+
+    ctx->pending_area.x_min = MIN(ctx->pending_area.x_min, landed.x_min);
+    ctx->pending_area.y_min = MIN(ctx->pending_area.y_min, landed.y_min);
+    ctx->pending_area.x_max = MAX(ctx->pending_area.x_max, landed.x_max);
+    ctx->pending_area.y_max = MAX(ctx->pending_area.y_max, landed.y_max);
+
+    if(!composited && !bounded && single && clip.x_min == 0 && clip.y_min == 0
+       && clip.x_max == (int32_t)target->width && clip.y_max == (int32_t)target->height) {
+        TVG_CHECK_RETURN_RESULT(paint->blend(blend_method_conv(blend)));
+        return ctx->canvas->push(std::move(paint));
+    }
+
+    auto shape = Shape::gen();
+    if(single) {
+        TVG_CHECK_RETURN_RESULT(shape->appendRect(area.x_min, area.y_min, area.x_max - area.x_min,
+                                                  area.y_max - area.y_min, 0, 0));
+    }
+    else {
+        for(const auto & rect : ctx->scissor_rects) {
+            vg_lite_float_t x_min = MAX((vg_lite_float_t)rect.x, area.x_min);
+            vg_lite_float_t y_min = MAX((vg_lite_float_t)rect.y, area.y_min);
+            vg_lite_float_t x_max = MIN((vg_lite_float_t)(rect.x + rect.width), area.x_max);
+            vg_lite_float_t y_max = MIN((vg_lite_float_t)(rect.y + rect.height), area.y_max);
+
+            if(x_min < x_max && y_min < y_max) {
+                TVG_CHECK_RETURN_RESULT(shape->appendRect(x_min, y_min, x_max - x_min, y_max - y_min, 0, 0));
+            }
+        }
+    }
+
+    std::unique_ptr<Paint> clipped;
+
+    /* a paint has a single composition, the one already clipped is wrapped into a scene */
+    if(paint->composite(nullptr) == CompositeMethod::None) {
+        TVG_CHECK_RETURN_RESULT(paint->composite(std::move(shape), CompositeMethod::ClipPath));
+        clipped = std::move(paint);
+    }
+    else {
+        auto scene = Scene::gen();
+        TVG_CHECK_RETURN_RESULT(scene->push(std::move(paint)));
+        TVG_CHECK_RETURN_RESULT(scene->composite(std::move(shape), CompositeMethod::ClipPath));
+        clipped = std::move(scene);
+    }
+
+    /* the blend of a clipped paint wrapped into a scene applies to the scene */
+    TVG_CHECK_RETURN_RESULT(clipped->blend(blend_method_conv(blend)));
+
+    if(composited) {
+        return canvas_push_composited(ctx, std::move(clipped), alpha, &clip, blend);
+    }
+
+    return ctx->canvas->push(std::move(clipped));
+}
+
+static bool draw_is_culled(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_fbox_t * box,
+                           const vg_lite_matrix_t * matrix)
+{
+    /**
+     * Simulate the border culling of the hardware (gcFEATURE_BIT_VG_BORDER_CULLING):
+     * drop the command when its transformed bounding box misses the target or the scissor area.
+     */
+    vg_lite_fbox_t area;
+
+    switch(matrix_classify(matrix)) {
+        case MATRIX_CLASS_IDENTITY:
+            area = *box;
             break;
-        case VG_LITE_INDEX_8:
-            px_size = 8;
-            in += x;
-            shift = 0;
+
+        case MATRIX_CLASS_TRANSLATE:
+            area.x_min = box->x_min + matrix->m[0][2];
+            area.y_min = box->y_min + matrix->m[1][2];
+            area.x_max = box->x_max + matrix->m[0][2];
+            area.y_max = box->y_max + matrix->m[1][2];
             break;
+
         default:
-            LV_ASSERT(false);
-            return false;
+            /* an area crossing the horizon of a projection comes back unbounded and is kept */
+            vg_lite_matrix_transform_bbox(matrix, &box->x_min, &area.x_min, 1);
+            break;
     }
 
-    mask = (1 << px_size) - 1; /*E.g. px_size = 2; mask = 0x03*/
+    /* several scissor rects are tested by their bounding box */
+    vg_lite_ibox_t scissor;
+    scissor_get_clip(ctx, target, &scissor);
 
-    int32_t i;
-    for(i = 0; i < w_px; i++) {
-        uint8_t val_act = (*in >> shift) & mask;
-        out[i] = palette[val_act];
+    vg_lite_fbox_t clip = {
+        (vg_lite_float_t)scissor.x_min, (vg_lite_float_t)scissor.y_min,
+        (vg_lite_float_t)scissor.x_max, (vg_lite_float_t)scissor.y_max
+    };
 
-        shift -= px_size;
-        if(shift < 0) {
-            shift = 8 - px_size;
-            in++;
-        }
+    if(fbox_intersects(&clip, &area)) {
+        return false;
     }
+
+    ctx->culled_count++;
     return true;
 }
 
-static Result picture_load(vg_lite_ctx * ctx, std::unique_ptr<Picture> & picture, const vg_lite_buffer_t * source,
-                           vg_lite_color_t color)
+static bool path_is_culled(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                           const vg_lite_matrix_t * matrix)
 {
-    vg_lite_uint32_t * image_buffer;
+    vg_lite_fbox_t box = {
+        path->bounding_box[0],
+        path->bounding_box[1],
+        path->bounding_box[2],
+        path->bounding_box[3]
+    };
 
-    /* At least 8-byte alignment */
-    LV_ASSERT(VG_LITE_IS_ALIGNED(source->memory, 8));
+    /* unbounded path, nothing to test against */
+    if(math_equal(box.x_min, -FLT_MAX) || math_equal(box.y_min, -FLT_MAX)
+       || math_equal(box.x_max, FLT_MAX) || math_equal(box.y_max, FLT_MAX)) {
+        return false;
+    }
+
+    return draw_is_culled(ctx, target, &box, matrix);
+}
+
+static Result canvas_flush(vg_lite_ctx * ctx)
+{
+    /* render the pending paints without releasing the target */
+    Result draw_res = ctx->canvas->draw();
+    ctx->pending_area = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    if(draw_res == Result::InsufficientCondition) {
+        /* nothing pushed */
+        return Result::Success;
+    }
+
+    TVG_CHECK_RETURN_RESULT(draw_res);
+    TVG_CHECK_RETURN_RESULT(ctx->canvas->sync());
+#if LV_VG_LITE_THORVG_USE_RELEASE
+    TVG_CHECK_RETURN_RESULT(ctx->canvas->clear(true));
+#else
+    TVG_CHECK_RETURN_RESULT(ctx->canvas->clear(true, false));
+#endif
+
+    ctx->target_dirty = true;
+    return Result::Success;
+}
 
+static Result canvas_flush_area(vg_lite_ctx * ctx, const vg_lite_ibox_t * clip, const vg_lite_fbox_t * extent,
+                                const vg_lite_buffer_t * source)
+{
     /**
-     * Since ThorVG's picture->load does not support stride,
-     * reconversion is required when the stride and width do not match.
+     * The built-in rasterizer writes the target right away, within 'clip' and 'extent' when given.
+     * The pending paints land first only when it overlaps them, otherwise they keep batching.
+     * A 'source' read from the target needs all of them.
      */
-    if(source->format == VG_LITE_BGRA8888
-       && source->image_mode == VG_LITE_NORMAL_IMAGE_MODE
-       && (size_t)source->stride == (size_t)(source->width * sizeof(vg_lite_uint32_t))) {
-        image_buffer = (vg_lite_uint32_t *)source->memory;
+    if(source && source->memory == ctx->target_buffer) {
+        return canvas_flush(ctx);
     }
-    else {
-        vg_lite_uint32_t width = source->width;
-        vg_lite_uint32_t height = source->height;
-        image_buffer = ctx->get_image_buffer(width, height);
 
-        vg_lite_buffer_t target;
-        memset(&target, 0, sizeof(target));
-        target.memory = image_buffer;
-        target.format = VG_LITE_BGRA8888;
-        target.width = width;
-        target.height = height;
-        target.stride = width * sizeof(vg_lite_uint32_t);
+    const vg_lite_ibox_t * pending = &ctx->pending_area;
+    vg_lite_ibox_t overlap = {
+        MAX(clip->x_min, pending->x_min), MAX(clip->y_min, pending->y_min),
+        MIN(clip->x_max, pending->x_max), MIN(clip->y_max, pending->y_max)
+    };
 
-        switch(source->format) {
-            case VG_LITE_INDEX_1:
-            case VG_LITE_INDEX_2:
-            case VG_LITE_INDEX_4:
-            case VG_LITE_INDEX_8: {
-                    const vg_lite_uint32_t * clut_colors = ctx->get_CLUT(source->format);
-                    for(vg_lite_uint32_t y = 0; y < height; y++) {
-                        decode_indexed_line(source->format, clut_colors, 0, y, width, source->stride, (uint8_t *)source->memory, image_buffer);
-                    }
+    vg_lite_fbox_t area = {
+        (vg_lite_float_t)overlap.x_min, (vg_lite_float_t)overlap.y_min,
+        (vg_lite_float_t)overlap.x_max, (vg_lite_float_t)overlap.y_max
+    };
+
+    if(extent) {
+        area.x_min = MAX(area.x_min, extent->x_min);
+        area.y_min = MAX(area.y_min, extent->y_min);
+        area.x_max = MIN(area.x_max, extent->x_max);
+        area.y_max = MIN(area.y_max, extent->y_max);
+    }
+
+    if(area.x_min >= area.x_max || area.y_min >= area.y_max) {
+        return Result::Success;
+    }
+
+    return canvas_flush(ctx);
+}
+
+static inline void polygon_add_point(vg_lite_polygon_t * polygon, vg_lite_fpoint_t p)
+{
+    polygon->points.push_back(p);
+    polygon->contours.back().count++;
+    fbox_add_point(&polygon->extents, p.x, p.y);
+}
+
+static inline void polygon_begin_contour(vg_lite_polygon_t * polygon, vg_lite_fpoint_t p)
+{
+    vg_lite_contour_t contour = { (vg_lite_uint32_t)polygon->points.size(), 0, false };
+    polygon->contours.push_back(contour);
+    polygon_add_point(polygon, p);
+}
+
+static inline vg_lite_float_t flatten_segments(vg_lite_float_t dd, vg_lite_float_t tolerance)
+{
+    /* the error of a uniform subdivision is bounded by max|B''| / (8 * n^2) */
+    vg_lite_float_t n = ceilf(sqrtf(dd / (8 * tolerance)));
+    return MAX(n, 1.0f);
+}
+
+static inline vg_lite_fpoint_t point_mid(vg_lite_fpoint_t a, vg_lite_fpoint_t b)
+{
+    vg_lite_fpoint_t p = { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f };
+    return p;
+}
+
+static void flatten_quad(vg_lite_polygon_t * polygon, vg_lite_fpoint_t p0, vg_lite_fpoint_t p1, vg_lite_fpoint_t p2,
+                         vg_lite_float_t tolerance, int depth)
+{
+    vg_lite_float_t dd = 2 * point_length(p0.x - 2 * p1.x + p2.x, p0.y - 2 * p1.y + p2.y);
+    vg_lite_float_t n = flatten_segments(dd, tolerance);
+
+    if(n > FLATTEN_SEGMENTS_MAX && depth < FLATTEN_DEPTH_MAX) {
+        /* each half has a quarter of the curvature, it needs half of the segments */
+        vg_lite_fpoint_t q0 = point_mid(p0, p1);
+        vg_lite_fpoint_t q1 = point_mid(p1, p2);
+        vg_lite_fpoint_t m = point_mid(q0, q1);
+        flatten_quad(polygon, p0, q0, m, tolerance, depth + 1);
+        flatten_quad(polygon, m, q1, p2, tolerance, depth + 1);
+        return;
+    }
+
+    vg_lite_uint32_t count = (vg_lite_uint32_t)MIN(n, (vg_lite_float_t)FLATTEN_SEGMENTS_MAX);
+    for(vg_lite_uint32_t i = 1; i < count; i++) {
+        vg_lite_float_t t = (vg_lite_float_t)i / count;
+        vg_lite_float_t u = 1 - t;
+        vg_lite_fpoint_t p = {
+            u * u * p0.x + 2 * u * t * p1.x + t * t * p2.x,
+            u * u * p0.y + 2 * u * t * p1.y + t * t * p2.y
+        };
+        polygon_add_point(polygon, p);
+    }
+
+    polygon_add_point(polygon, p2);
+}
+
+static void flatten_cubic(vg_lite_polygon_t * polygon, vg_lite_fpoint_t p0, vg_lite_fpoint_t p1, vg_lite_fpoint_t p2,
+                          vg_lite_fpoint_t p3, vg_lite_float_t tolerance, int depth)
+{
+    vg_lite_float_t d1 = point_length(p0.x - 2 * p1.x + p2.x, p0.y - 2 * p1.y + p2.y);
+    vg_lite_float_t d2 = point_length(p1.x - 2 * p2.x + p3.x, p1.y - 2 * p2.y + p3.y);
+    vg_lite_float_t n = flatten_segments(6 * (MAX(d1, d2)), tolerance);
+
+    if(n > FLATTEN_SEGMENTS_MAX && depth < FLATTEN_DEPTH_MAX) {
+        /* de Casteljau at the middle */
+        vg_lite_fpoint_t q0 = point_mid(p0, p1);
+        vg_lite_fpoint_t q1 = point_mid(p1, p2);
+        vg_lite_fpoint_t q2 = point_mid(p2, p3);
+        vg_lite_fpoint_t r0 = point_mid(q0, q1);
+        vg_lite_fpoint_t r1 = point_mid(q1, q2);
+        vg_lite_fpoint_t m = point_mid(r0, r1);
+        flatten_cubic(polygon, p0, q0, r0, m, tolerance, depth + 1);
+        flatten_cubic(polygon, m, r1, q2, p3, tolerance, depth + 1);
+        return;
+    }
+
+    vg_lite_uint32_t count = (vg_lite_uint32_t)MIN(n, (vg_lite_float_t)FLATTEN_SEGMENTS_MAX);
+    for(vg_lite_uint32_t i = 1; i < count; i++) {
+        vg_lite_float_t t = (vg_lite_float_t)i / count;
+        vg_lite_float_t u = 1 - t;
+        vg_lite_float_t b0 = u * u * u;
+        vg_lite_float_t b1 = 3 * u * u * t;
+        vg_lite_float_t b2 = 3 * u * t * t;
+        vg_lite_float_t b3 = t * t * t;
+        vg_lite_fpoint_t p = {
+            b0 * p0.x + b1 * p1.x + b2 * p2.x + b3 * p3.x,
+            b0 * p0.y + b1 * p1.y + b2 * p2.y + b3 * p3.y
+        };
+        polygon_add_point(polygon, p);
+    }
+
+    polygon_add_point(polygon, p3);
+}
+
+static bool path_flatten(vg_lite_polygon_t * polygon, const vg_lite_path_t * path, vg_lite_float_t tolerance)
+{
+    polygon->points.clear();
+    polygon->contours.clear();
+    polygon->extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+    polygon->path_extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    uint8_t fmt_len = vlc_format_len(path->format);
+    uint8_t * cur = (uint8_t *)path->path;
+    uint8_t * end = cur + path->path_length;
+
+    /* current point and start point of the subpath */
+    vg_lite_fpoint_t last = { 0, 0 };
+    vg_lite_fpoint_t start = { 0, 0 };
+    bool in_contour = false;
+
+    auto transform = [polygon](float x, float y) -> vg_lite_fpoint_t {
+        vg_lite_fpoint_t p = { x, y };
+        fbox_add_point(&polygon->path_extents, x, y);
+        return p;
+    };
+
+    while(cur < end) {
+        /* get op code */
+        uint8_t op_code = VLC_GET_OP_CODE(cur);
+
+        /* get arguments length */
+        uint8_t arg_len = vlc_op_arg_len(op_code);
+
+        /* skip op code */
+        cur += fmt_len;
+
+        if(!in_contour && (op_code == VLC_OP_LINE || op_code == VLC_OP_QUAD || op_code == VLC_OP_CUBIC)) {
+            /* drawing without a move continues from the last point */
+            polygon_begin_contour(polygon, last);
+            start = last;
+            in_contour = true;
+        }
+
+        switch(op_code) {
+            case VLC_OP_MOVE: {
+                    float x = VLC_GET_ARG(cur, 0);
+                    float y = VLC_GET_ARG(cur, 1);
+                    last = start = transform(x, y);
+                    polygon_begin_contour(polygon, last);
+                    in_contour = true;
+                }
+                break;
+
+            case VLC_OP_LINE: {
+                    float x = VLC_GET_ARG(cur, 0);
+                    float y = VLC_GET_ARG(cur, 1);
+                    last = transform(x, y);
+                    polygon_add_point(polygon, last);
+                }
+                break;
+
+            case VLC_OP_QUAD: {
+                    float cx = VLC_GET_ARG(cur, 0);
+                    float cy = VLC_GET_ARG(cur, 1);
+                    float x = VLC_GET_ARG(cur, 2);
+                    float y = VLC_GET_ARG(cur, 3);
+                    vg_lite_fpoint_t p0 = last;
+                    vg_lite_fpoint_t p1 = transform(cx, cy);
+                    vg_lite_fpoint_t p2 = transform(x, y);
+
+                    flatten_quad(polygon, p0, p1, p2, tolerance, 0);
+                    last = p2;
+                }
+                break;
+
+            case VLC_OP_CUBIC: {
+                    float cx1 = VLC_GET_ARG(cur, 0);
+                    float cy1 = VLC_GET_ARG(cur, 1);
+                    float cx2 = VLC_GET_ARG(cur, 2);
+                    float cy2 = VLC_GET_ARG(cur, 3);
+                    float x = VLC_GET_ARG(cur, 4);
+                    float y = VLC_GET_ARG(cur, 5);
+                    vg_lite_fpoint_t p0 = last;
+                    vg_lite_fpoint_t p1 = transform(cx1, cy1);
+                    vg_lite_fpoint_t p2 = transform(cx2, cy2);
+                    vg_lite_fpoint_t p3 = transform(x, y);
+
+                    flatten_cubic(polygon, p0, p1, p2, p3, tolerance, 0);
+                    last = p3;
+                }
+                break;
+
+            case VLC_OP_CLOSE:
+                if(in_contour) {
+                    polygon->contours.back().closed = true;
+                    last = start;
+                    in_contour = false;
                 }
                 break;
 
-            case VG_LITE_A4: {
-                    conv_alpha4_to_bgra8888.convert(&target, source, color);
-                }
-                break;
+            default:
+                break;
+        }
+
+        cur += arg_len * fmt_len;
+    }
+
+    return !polygon->points.empty();
+}
+
+static vg_lite_uint32_t path_data_hash(const vg_lite_path_t * path)
+{
+    /* FNV-1a, tells apart the contents a reused path data pointer had */
+    const uint8_t * data = (const uint8_t *)path->path;
+    vg_lite_uint32_t hash = 0x811C9DC5;
+
+    for(vg_lite_uint32_t i = 0; i < path->path_length; i++) {
+        hash = (hash ^ data[i]) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static bool polyline_can_merge(const vg_lite_fpoint_t * pts, vg_lite_uint32_t anchor, vg_lite_uint32_t next,
+                               vg_lite_float_t tolerance)
+{
+    /* all the points between 'anchor' and 'next' must stay close to the chord */
+    const vg_lite_fpoint_t * a = &pts[anchor];
+    const vg_lite_fpoint_t * b = &pts[next];
+    vg_lite_float_t dx = b->x - a->x;
+    vg_lite_float_t dy = b->y - a->y;
+    vg_lite_float_t len2 = dx * dx + dy * dy;
+
+    for(vg_lite_uint32_t i = anchor + 1; i < next; i++) {
+        vg_lite_float_t px = pts[i].x - a->x;
+        vg_lite_float_t py = pts[i].y - a->y;
+
+        if(len2 < FLT_EPSILON) {
+            if(point_length(px, py) > tolerance) {
+                return false;
+            }
+            continue;
+        }
+
+        /* a point beyond the chord ends is a spike, which matters for strokes */
+        vg_lite_float_t dot = px * dx + py * dy;
+        if(dot < 0 || dot > len2) {
+            return false;
+        }
+
+        vg_lite_float_t cross = px * dy - py * dx;
+        if(cross * cross > tolerance * tolerance * len2) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void polygon_simplify(vg_lite_polygon_t * polygon, vg_lite_float_t tolerance, vg_lite_float_t min_extent)
+{
+    /* longest run of points merged into one segment, bounds the cost of the chord test */
+    const vg_lite_uint32_t max_run = 32;
+
+    vg_lite_fpoint_t * pts = polygon->points.data();
+    vg_lite_uint32_t write = 0;
+    size_t contour_count = 0;
+
+    polygon->extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for(size_t c = 0; c < polygon->contours.size(); c++) {
+        vg_lite_contour_t contour = polygon->contours[c];
+        const vg_lite_fpoint_t * src = pts + contour.begin;
+
+        vg_lite_fbox_t box = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for(vg_lite_uint32_t i = 0; i < contour.count; i++) {
+            fbox_add_point(&box, src[i].x, src[i].y);
+        }
+
+        /* sub-pixel subpaths of a fill can't be seen */
+        if(contour.count < 2 || (box.x_max - box.x_min < min_extent && box.y_max - box.y_min < min_extent)) {
+            continue;
+        }
+
+        vg_lite_uint32_t begin = write;
+        vg_lite_uint32_t anchor = 0;
+        pts[write++] = src[0];
+
+        for(vg_lite_uint32_t i = 1; i + 1 < contour.count; i++) {
+            if(i - anchor < max_run && polyline_can_merge(src, anchor, i + 1, tolerance)) {
+                continue;
+            }
+
+            anchor = i;
+            pts[write++] = src[i];
+        }
+
+        /* the end point is always kept, the chord test above may have skipped the points before it */
+        pts[write++] = src[contour.count - 1];
+
+        for(vg_lite_uint32_t i = begin; i < write; i++) {
+            fbox_add_point(&polygon->extents, pts[i].x, pts[i].y);
+        }
+
+        contour.begin = begin;
+        contour.count = write - begin;
+        polygon->contours[contour_count++] = contour;
+    }
+
+    polygon->points.resize(write);
+    polygon->contours.resize(contour_count);
+}
+
+static const vg_lite_lod_t * path_get_lod(vg_lite_ctx * ctx, const vg_lite_path_t * path,
+                                          const vg_lite_matrix_t * matrix)
+{
+    /**
+     * Paths are flattened in path space with a tolerance derived from the matrix scale,
+     * so a path shown small is simplified down to the few segments that can be seen.
+     * The result only depends on the scale bucket and is cached across frames.
+     * The data is hashed when an entry is made and once after each vg_lite_init_path(),
+     * which marks the path as changed: the entries of other contents are dropped then.
+     * A hit reads nothing of the path otherwise.
+     */
+    vg_lite_uint32_t hash = 0;
+    bool changed = path->path_changed != 0;
+
+    if(changed) {
+        hash = path_data_hash(path);
+
+        /* the flag is the driver's, it tells the data was not seen since it was set */
+        const_cast<vg_lite_path_t *>(path)->path_changed = 0;
+
+        for(auto it = ctx->lod_cache.begin(); it != ctx->lod_cache.end();) {
+            if(it->key.data == path->path && it->hash != hash) {
+                ctx->lod_index.erase(it->key);
+                it = ctx->lod_cache.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    vg_lite_float_t scale = MAX(matrix_get_scale(matrix), 1.0f / 1024);
+    int32_t bucket = (int32_t)ceilf(log2f(scale) * LOD_BUCKETS_PER_OCTAVE);
+
+    vg_lite_lod_key_t key;
+    key.data = path->path;
+    key.length = path->path_length;
+    key.format = path->format;
+    key.quality = path->quality;
+    key.is_fill = !(path->path_type & VG_LITE_DRAW_STROKE_PATH);
+    key.scale_bucket = bucket;
+
+    auto & cache = ctx->lod_cache;
+
+    auto found = ctx->lod_index.find(key);
+    if(found != ctx->lod_index.end()) {
+        cache.splice(cache.begin(), cache, found->second);
+        return &cache.front();
+    }
+
+    if(cache.size() < LV_VG_LITE_THORVG_LOD_CACHE_CNT) {
+        cache.emplace_front();
+    }
+    else {
+        /* recycle the least recently used entry, keeping its allocations */
+        ctx->lod_index.erase(cache.back().key);
+        cache.splice(cache.begin(), cache, std::prev(cache.end()));
+    }
+
+    vg_lite_lod_t * lod = &cache.front();
+    lod->key = key;
+    lod->hash = changed ? hash : path_data_hash(path);
+    ctx->lod_index[key] = cache.begin();
+
+    /* the bucket scale is never below the real one, the tolerance errs on the fine side */
+    vg_lite_float_t bucket_scale = exp2f((vg_lite_float_t)bucket / LOD_BUCKETS_PER_OCTAVE);
+    vg_lite_float_t tolerance = quality_tier_get(path->quality)->tolerance / bucket_scale;
+
+    /* half of the error budget for the curves, half for merging the segments */
+    path_flatten(&lod->polygon, path, tolerance / 2);
+    polygon_simplify(&lod->polygon, tolerance / 2, key.is_fill ? tolerance : 0);
+
+    lod->cmds.clear();
+    lod->pts.clear();
+
+    for(const auto & contour : lod->polygon.contours) {
+        const vg_lite_fpoint_t * src = lod->polygon.points.data() + contour.begin;
+
+        for(vg_lite_uint32_t i = 0; i < contour.count; i++) {
+            Point pt = { src[i].x, src[i].y };
+            lod->cmds.push_back(i == 0 ? PathCommand::MoveTo : PathCommand::LineTo);
+            lod->pts.push_back(pt);
+        }
+
+        if(contour.closed) {
+            lod->cmds.push_back(PathCommand::Close);
+        }
+    }
+
+    return lod;
+}
+
+static void path_drop_lod(vg_lite_ctx * ctx, const vg_lite_path_t * path)
+{
+    auto & cache = ctx->lod_cache;
+
+    for(auto it = cache.begin(); it != cache.end();) {
+        if(it->key.data == path->path) {
+            ctx->lod_index.erase(it->key);
+            it = cache.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+static void polygon_transform(vg_lite_polygon_t * dest, const vg_lite_polygon_t * src, const vg_lite_matrix_t * matrix)
+{
+    dest->contours = src->contours;
+    dest->path_extents = src->path_extents;
+    dest->points.resize(src->points.size());
+    dest->extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    if(src->points.empty()) {
+        return;
+    }
+
+    if(matrix) {
+        vg_lite_matrix_transform_points(matrix, &src->points[0].x, &dest->points[0].x, (vg_lite_uint32_t)src->points.size());
+    }
+    else {
+        dest->points = src->points;
+    }
+
+    for(const auto & p : dest->points) {
+        fbox_add_point(&dest->extents, p.x, p.y);
+    }
+}
+
+static inline vg_lite_uint32_t pixel_lerp(vg_lite_uint32_t a, vg_lite_uint32_t b, vg_lite_uint32_t f)
+{
+    /* 'f' is in range 0 ~ 256, the weighted lanes stay within 16 bits */
+    vg_lite_uint32_t inv = 256 - f;
+    vg_lite_uint32_t rb = ((((a & 0x00ff00ff) * inv) + ((b & 0x00ff00ff) * f)) >> 8) & 0x00ff00ff;
+    vg_lite_uint32_t ag = ((((a >> 8) & 0x00ff00ff) * inv) + (((b >> 8) & 0x00ff00ff) * f)) & 0xff00ff00;
+    return rb | ag;
+}
+
+static void mask_blend_row(uint8_t * dest, const uint8_t * src, int32_t len, vg_lite_mask_operation_t operation)
+{
+    switch(operation) {
+        case VG_LITE_CLEAR_MASK:
+            memset(dest, 0, len);
+            return;
+        case VG_LITE_FILL_MASK:
+            memset(dest, 0xFF, len);
+            return;
+        case VG_LITE_SET_MASK:
+            memcpy(dest, src, len);
+            return;
+        case VG_LITE_UNION_MASK:
+        case VG_LITE_INTERSECT_MASK:
+        case VG_LITE_SUBTRACT_MASK:
+            break;
+        default:
+            LV_ASSERT(false);
+            return;
+    }
+
+    /* the three others only differ by how the product d * s is added, it never exceeds d or s */
+    int32_t i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for(; i + 16 <= len; i += 16) {
+        uint8x16_t d = vld1q_u8(dest + i);
+        uint8x16_t s = vld1q_u8(src + i);
+        uint16x8_t lo = vmull_u8(vget_low_u8(d), vget_low_u8(s));
+        uint16x8_t hi = vmull_u8(vget_high_u8(d), vget_high_u8(s));
+        uint8x16_t ds = vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(lo, lo, 8), 8),
+                                    vrshrn_n_u16(vrsraq_n_u16(hi, hi, 8), 8));
+        uint8x16_t out = operation == VG_LITE_INTERSECT_MASK ? ds
+                         : operation == VG_LITE_UNION_MASK ? vaddq_u8(d, vsubq_u8(s, ds)) : vsubq_u8(d, ds);
+        vst1q_u8(dest + i, out);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+
+    for(; i + 16 <= len; i += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero)), half);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero)), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i ds = _mm_packus_epi16(lo, hi);
+        __m128i out = operation == VG_LITE_INTERSECT_MASK ? ds
+                      : operation == VG_LITE_UNION_MASK ? _mm_add_epi8(d, _mm_sub_epi8(s, ds)) : _mm_sub_epi8(d, ds);
+        _mm_storeu_si128((__m128i *)(dest + i), out);
+    }
+#endif
+
+    for(; i < len; i++) {
+        uint8_t ds = mul_div255(dest[i], src[i]);
+        dest[i] = operation == VG_LITE_INTERSECT_MASK ? ds
+                  : operation == VG_LITE_UNION_MASK ? (uint8_t)(dest[i] + src[i] - ds) : (uint8_t)(dest[i] - ds);
+    }
+}
+
+static void mask_update(vg_lite_ctx * ctx)
+{
+    /* the rasterizer reads the mask directly, it is the only state the draws look at */
+    vg_lite_raster_t * raster = &ctx->raster;
+    const vg_lite_buffer_t * mask = ctx->mask_enabled ? ctx->masklayer : nullptr;
+
+    raster->mask = mask ? (const uint8_t *)mask->memory : nullptr;
+    raster->mask_stride = mask ? mask->stride : 0;
+    raster->mask_width = mask ? mask->width : 0;
+    raster->mask_height = mask ? mask->height : 0;
+}
+
+static Result canvas_push_composited(vg_lite_ctx * ctx, std::unique_ptr<Paint> paint, vg_lite_uint32_t alpha,
+                                     const vg_lite_ibox_t * clip, vg_lite_blend_t blend)
+{
+    /**
+     * thorvg has no coverage input, the paint is rendered alone over a copy of the area
+     * it is clipped to, then that copy is blended back with the mask as the weight.
+     * A blend mode thorvg does not have renders the paint over a cleared area instead, which
+     * gives the source already scaled by its coverage: the rendered alpha over 'alpha' is that
+     * coverage, it is divided out of the source so the compositor applies it once. It is exact
+     * for the paints of a single color and for the opaque ones. SRC_IN and DST_IN also change
+     * the target where the source is transparent, the whole area is covered for them.
+     * The fills reach this only when the built-in rasterizer cannot take them.
+     */
+    TVG_CHECK_RETURN_RESULT(canvas_flush(ctx));
+
+    const vg_lite_raster_t * raster = &ctx->raster;
+    bool native = blend_is_native(blend) && raster->dest_alpha_mode == VG_LITE_NORMAL;
+    bool outside = blend == VG_LITE_BLEND_SRC_IN || blend == VG_LITE_BLEND_DST_IN
+                   || blend == OPENVG_BLEND_SRC_IN || blend == OPENVG_BLEND_DST_IN;
+    int32_t width = clip->x_max - clip->x_min;
+    int32_t height = clip->y_max - clip->y_min;
+    vg_lite_uint32_t stride = ctx->tvg_target_stride;
+    vg_lite_uint32_t * target = (vg_lite_uint32_t *)ctx->tvg_target_buffer + clip->y_min * stride + clip->x_min;
+
+    ctx->composite_backup.resize(width * height);
+    vg_lite_uint32_t * saved = ctx->composite_backup.data();
+
+    for(int32_t y = 0; y < height; y++) {
+        memcpy(saved + y * width, target + y * stride, width * sizeof(vg_lite_uint32_t));
+        if(!native) {
+            memset(target + y * stride, 0, width * sizeof(vg_lite_uint32_t));
+        }
+    }
+
+    TVG_CHECK_RETURN_RESULT(ctx->canvas->push(std::move(paint)));
+    TVG_CHECK_RETURN_RESULT(canvas_flush(ctx));
+
+    if(!native) {
+        ctx->composite_source.resize(width);
+        ctx->composite_coverage.resize(width);
+    }
+
+    for(int32_t y = 0; y < height; y++) {
+        const uint8_t * mask = raster->mask ? raster->mask + (clip->y_min + y) * raster->mask_stride + clip->x_min
+                               : nullptr;
+        const vg_lite_uint32_t * src = saved + y * width;
+        vg_lite_uint32_t * dest = target + y * stride;
+
+        if(!native) {
+            vg_lite_uint32_t * source = ctx->composite_source.data();
+            uint8_t * coverage = ctx->composite_coverage.data();
+
+            for(int32_t x = 0; x < width; x++) {
+                vg_lite_uint32_t c = 0xFF;
+                source[x] = dest[x];
+
+                if(!outside) {
+                    c = A(dest[x]) >= alpha ? 0xFF : A(dest[x]) * 0xFF / alpha;
+                    source[x] = pixel_unscale(dest[x], c);
+                }
+
+                coverage[x] = mask ? mul_div255(c, mask[x]) : (uint8_t)c;
+            }
+
+            memcpy(dest, src, width * sizeof(vg_lite_uint32_t));
+            blend_span(&ctx->raster, blend, dest, source, coverage, width);
+            continue;
+        }
+
+        for(int32_t x = 0; x < width; x++) {
+            vg_lite_uint32_t m = mask[x];
+            if(m == 0xFF) {
+                continue;
+            }
+
+            dest[x] = m == 0 ? src[x] : pixel_lerp(src[x], dest[x], m + (m >> 7));
+        }
+    }
+
+    return Result::Success;
+}
+
+static inline bool sampler_is_inside(const vg_lite_sampler_t * sampler, int32_t x, int32_t y, int32_t size)
+{
+    /* the size x size texels at (x, y) can be read without the pattern mode */
+    return x >= sampler->box.x_min && y >= sampler->box.y_min
+           && x + size <= sampler->box.x_max && y + size <= sampler->box.y_max;
+}
+
+static inline int32_t sampler_wrap(vg_lite_pattern_mode_t mode, int32_t t, int32_t min, int32_t max)
+{
+    int32_t size = max - min;
+    t -= min;
+
+    switch(mode) {
+        case VG_LITE_PATTERN_REPEAT:
+            t %= size;
+            t += t < 0 ? size : 0;
+            break;
+
+        case VG_LITE_PATTERN_REFLECT:
+            /* every other tile is mirrored, the edge texels are repeated at the fold */
+            t %= size * 2;
+            t += t < 0 ? size * 2 : 0;
+            t = t < size ? t : size * 2 - 1 - t;
+            break;
+
+        default:
+            t = CLAMP(t, 0, size - 1);
+            break;
+    }
+
+    return t + min;
+}
+
+static inline vg_lite_uint32_t sampler_texel(const vg_lite_sampler_t * sampler, int32_t x, int32_t y)
+{
+    const vg_lite_ibox_t * box = &sampler->box;
+
+    if(x < box->x_min || y < box->y_min || x >= box->x_max || y >= box->y_max) {
+        if(sampler->mode == VG_LITE_PATTERN_COLOR) {
+            return sampler->border;
+        }
+
+        x = sampler_wrap(sampler->mode, x, box->x_min, box->x_max);
+        y = sampler_wrap(sampler->mode, y, box->y_min, box->y_max);
+    }
+
+    return sampler->image[y * sampler->stride + x];
+}
+
+static inline vg_lite_uint32_t sampler_fetch_bilinear(const vg_lite_sampler_t * sampler, int32_t u, int32_t v)
+{
+    /* the texel centers are at the half coordinates */
+    u -= 0x8000;
+    v -= 0x8000;
+
+    int32_t x = u >> 16;
+    int32_t y = v >> 16;
+    vg_lite_uint32_t fx = (u >> 8) & 0xFF;
+    vg_lite_uint32_t fy = (v >> 8) & 0xFF;
+
+    if(sampler_is_inside(sampler, x, y, 2)) {
+        const vg_lite_uint32_t * p = sampler->image + y * sampler->stride + x;
+        return pixel_lerp(pixel_lerp(p[0], p[1], fx), pixel_lerp(p[sampler->stride], p[sampler->stride + 1], fx), fy);
+    }
+
+    return pixel_lerp(pixel_lerp(sampler_texel(sampler, x, y), sampler_texel(sampler, x + 1, y), fx),
+                      pixel_lerp(sampler_texel(sampler, x, y + 1), sampler_texel(sampler, x + 1, y + 1), fx), fy);
+}
+
+static inline vg_lite_uint32_t sampler_fetch_gaussian(const vg_lite_sampler_t * sampler, int32_t u, int32_t v)
+{
+    /* weight index of the 3x3 block: | w2 w1 w2 | w1 w0 w1 | w2 w1 w2 | */
+    static const uint8_t weight_index[9] = { 2, 1, 2, 1, 0, 1, 2, 1, 2 };
+
+    int32_t x = (u >> 16) - 1;
+    int32_t y = (v >> 16) - 1;
+    bool inside = sampler_is_inside(sampler, x, y, 3);
+    const vg_lite_uint32_t * p = inside ? sampler->image + y * sampler->stride + x : nullptr;
+
+    /* the weights sum up to 256, the lanes of the accumulators stay within 16 bits */
+    vg_lite_uint32_t rb = 0;
+    vg_lite_uint32_t ag = 0;
+
+    for(int32_t k = 0; k < 9; k++) {
+        int32_t i = k % 3;
+        int32_t j = k / 3;
+        vg_lite_uint32_t texel = inside ? p[j * sampler->stride + i] : sampler_texel(sampler, x + i, y + j);
+        vg_lite_uint32_t w = sampler->gaussian[weight_index[k]];
+
+        rb += (texel & 0x00ff00ff) * w;
+        ag += ((texel >> 8) & 0x00ff00ff) * w;
+    }
+
+    return ((rb >> 8) & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+static void sampler_fetch_run(const vg_lite_sampler_t * sampler, int32_t u, int32_t v, int32_t du, int32_t dv,
+                              int32_t len, vg_lite_uint32_t * out)
+{
+    /* 'u' and 'v' are the 16.16 texel coordinates of the first pixel center */
+    if(du == 0x10000 && dv == 0 && sampler->filter != VG_LITE_FILTER_GAUSSIAN
+       && (sampler->filter == VG_LITE_FILTER_POINT || ((u & 0xFFFF) == 0x8000 && (v & 0xFFFF) == 0x8000))) {
+        /* the pixels are on the texel centers, the run is a copy of the source row */
+        int32_t tx = u >> 16;
+        int32_t ty = v >> 16;
+
+        if(ty >= sampler->box.y_min && ty < sampler->box.y_max && tx >= sampler->box.x_min
+           && tx + len <= sampler->box.x_max) {
+            memcpy(out, sampler->image + ty * sampler->stride + tx, len * sizeof(vg_lite_uint32_t));
+            return;
+        }
+    }
+
+    switch(sampler->filter) {
+        case VG_LITE_FILTER_POINT:
+            for(int32_t i = 0; i < len; i++, u += du, v += dv) {
+                out[i] = sampler_texel(sampler, u >> 16, v >> 16);
+            }
+            break;
+
+        case VG_LITE_FILTER_GAUSSIAN:
+            for(int32_t i = 0; i < len; i++, u += du, v += dv) {
+                out[i] = sampler_fetch_gaussian(sampler, u, v);
+            }
+            break;
+
+        default:
+            for(int32_t i = 0; i < len; i++, u += du, v += dv) {
+                out[i] = sampler_fetch_bilinear(sampler, u, v);
+            }
+            break;
+    }
+}
+
+static void sampler_fetch_span(const vg_lite_sampler_t * sampler, int32_t x, int32_t y, int32_t len,
+                               vg_lite_uint32_t * out)
+{
+    /**
+     * The source position is divided exactly at both ends of every 'step' pixels and interpolated
+     * linearly in between, which is one divide per 'step' pixels for a perspective matrix.
+     * The w of an affine matrix is 1 and the interpolation is exact.
+     */
+    const int32_t step = 16;
+    const vg_lite_float_t limit = (vg_lite_float_t)INT16_MAX;
+    const vg_lite_matrix_t * m = &sampler->inverse;
+
+    vg_lite_float_t py = y + 0.5f;
+    vg_lite_float_t u_row = m->m[0][1] * py + m->m[0][2];
+    vg_lite_float_t v_row = m->m[1][1] * py + m->m[1][2];
+    vg_lite_float_t w_row = m->m[2][1] * py + m->m[2][2];
+
+    for(int32_t i = 0; i < len; i += step) {
+        int32_t n = MIN(step, len - i);
+        vg_lite_float_t px0 = x + i + 0.5f;
+        vg_lite_float_t px1 = px0 + n;
+        vg_lite_float_t w0 = m->m[2][0] * px0 + w_row;
+        vg_lite_float_t w1 = m->m[2][0] * px1 + w_row;
+
+        if(w0 > 0 && w1 > 0) {
+            int32_t u0 = (int32_t)(CLAMP((m->m[0][0] * px0 + u_row) / w0, -limit, limit) * 65536.0f);
+            int32_t v0 = (int32_t)(CLAMP((m->m[1][0] * px0 + v_row) / w0, -limit, limit) * 65536.0f);
+            int32_t u1 = (int32_t)(CLAMP((m->m[0][0] * px1 + u_row) / w1, -limit, limit) * 65536.0f);
+            int32_t v1 = (int32_t)(CLAMP((m->m[1][0] * px1 + v_row) / w1, -limit, limit) * 65536.0f);
+
+            /* both ends may be near opposite limits, the difference is taken in 64 bits */
+            int64_t du = ((int64_t)u1 - u0) / n;
+            int64_t dv = ((int64_t)v1 - v0) / n;
+            sampler_fetch_run(sampler, u0, v0, (int32_t)CLAMP(du, (int64_t)INT32_MIN, (int64_t)INT32_MAX),
+                              (int32_t)CLAMP(dv, (int64_t)INT32_MIN, (int64_t)INT32_MAX), n, out + i);
+            continue;
+        }
+
+        /* the run crosses the horizon of the projection, nothing behind it is visible */
+        for(int32_t k = 0; k < n; k++) {
+            vg_lite_float_t px = px0 + k;
+            vg_lite_float_t w = m->m[2][0] * px + w_row;
+
+            if(w <= 0) {
+                out[i + k] = 0;
+                continue;
+            }
+
+            int32_t u = (int32_t)(CLAMP((m->m[0][0] * px + u_row) / w, -limit, limit) * 65536.0f);
+            int32_t v = (int32_t)(CLAMP((m->m[1][0] * px + v_row) / w, -limit, limit) * 65536.0f);
+            sampler_fetch_run(sampler, u, v, 0, 0, 1, out + i + k);
+        }
+    }
+}
+
+static inline bool blend_is_source_over(vg_lite_blend_t blend)
+{
+    /* the sources are premultiplied before they are blended, these only differ for the hardware input */
+    return blend == VG_LITE_BLEND_SRC_OVER || blend == VG_LITE_BLEND_NORMAL_LVGL
+           || blend == VG_LITE_BLEND_PREMULTIPLY_SRC_OVER || blend == OPENVG_BLEND_SRC_OVER;
+}
+
+static inline bool blend_keeps_dest(vg_lite_blend_t blend)
+{
+    /* a fully transparent source leaves the target as it is */
+    switch(blend) {
+        case VG_LITE_BLEND_NONE:
+        case VG_LITE_BLEND_SRC_IN:
+        case VG_LITE_BLEND_DST_IN:
+        case OPENVG_BLEND_SRC:
+        case OPENVG_BLEND_SRC_IN:
+        case OPENVG_BLEND_DST_IN:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static inline int32_t blend_channel(vg_lite_blend_t blend, int32_t s, int32_t d, int32_t sa, int32_t da)
+{
+    /* the formulas of vg_lite.h on premultiplied channels, the result is clamped by the caller */
+    switch(blend) {
+        case VG_LITE_BLEND_NONE:
+        case OPENVG_BLEND_SRC:
+            return s;
+        case VG_LITE_BLEND_DST_OVER:
+        case OPENVG_BLEND_DST_OVER:
+            return mul_div255(s, 255 - da) + d;
+        case VG_LITE_BLEND_SRC_IN:
+        case OPENVG_BLEND_SRC_IN:
+            return mul_div255(s, da);
+        case VG_LITE_BLEND_DST_IN:
+        case OPENVG_BLEND_DST_IN:
+            return mul_div255(d, sa);
+        case VG_LITE_BLEND_MULTIPLY:
+        case OPENVG_BLEND_MULTIPLY:
+            return mul_div255(s, 255 - da) + mul_div255(d, 255 - sa) + mul_div255(s, d);
+        case VG_LITE_BLEND_SCREEN:
+        case OPENVG_BLEND_SCREEN:
+            return s + d - mul_div255(s, d);
+        case VG_LITE_BLEND_DARKEN:
+        case OPENVG_BLEND_DARKEN: {
+                int32_t src_over = s + mul_div255(d, 255 - sa);
+                int32_t dst_over = d + mul_div255(s, 255 - da);
+                return MIN(src_over, dst_over);
+            }
+        case VG_LITE_BLEND_LIGHTEN:
+        case OPENVG_BLEND_LIGHTEN: {
+                int32_t src_over = s + mul_div255(d, 255 - sa);
+                int32_t dst_over = d + mul_div255(s, 255 - da);
+                return MAX(src_over, dst_over);
+            }
+        case VG_LITE_BLEND_ADDITIVE:
+        case VG_LITE_BLEND_ADDITIVE_LVGL:
+        case OPENVG_BLEND_ADDITIVE:
+            return s + d;
+        case VG_LITE_BLEND_SUBTRACT:
+            return mul_div255(d, 255 - sa);
+        case VG_LITE_BLEND_SUBTRACT_LVGL:
+            return d - s;
+        case VG_LITE_BLEND_MULTIPLY_LVGL:
+            return mul_div255(s, d) + mul_div255(d, 255 - sa);
+        default:
+            /* the source over modes */
+            return s + mul_div255(d, 255 - sa);
+    }
+}
+
+static inline bool blend_is_lvgl(vg_lite_blend_t blend)
+{
+    /* like the LVGL software blender, only the colors follow the formula, the alpha is source over */
+    return blend == VG_LITE_BLEND_SUBTRACT_LVGL || blend == VG_LITE_BLEND_ADDITIVE_LVGL
+           || blend == VG_LITE_BLEND_MULTIPLY_LVGL;
+}
+
+static vg_lite_uint32_t pixel_blend(vg_lite_blend_t blend, vg_lite_uint32_t src, vg_lite_uint32_t dest,
+                                    vg_lite_uint32_t read, vg_lite_uint32_t cov)
+{
+    /**
+     * The reference of the vector kernels, which compute the same values.
+     * 'read' is the target as the formula reads it, after its global alpha,
+     * 'dest' is what the coverage mixes the result with.
+     */
+    int32_t sa = A(src);
+    int32_t da = A(read);
+    bool lvgl = blend_is_lvgl(blend);
+    vg_lite_uint32_t out = 0;
+
+    for(int32_t shift = 0; shift < 32; shift += 8) {
+        int32_t s = (src >> shift) & 0xFF;
+        int32_t d = (read >> shift) & 0xFF;
+        int32_t r = shift == 24 && lvgl ? sa + mul_div255(da, 0xFF - sa) : blend_channel(blend, s, d, sa, da);
+        r = CLAMP(r, 0, 0xFF);
+
+        if(cov != 0xFF) {
+            r = mul_div255(r, cov) + mul_div255((dest >> shift) & 0xFF, 0xFF - cov);
+            r = MIN(r, 0xFF);
+        }
+
+        out |= (vg_lite_uint32_t)r << shift;
+    }
+
+    return out;
+}
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline int16x8_t blend_mul_neon(int16x8_t a, int16x8_t b)
+{
+    uint16x8_t p = vmulq_u16(vreinterpretq_u16_s16(a), vreinterpretq_u16_s16(b));
+    return vreinterpretq_s16_u16(vrshrq_n_u16(vrsraq_n_u16(p, p, 8), 8));
+}
+
+static inline int16x8_t blend_channel_neon(vg_lite_blend_t blend, int16x8_t s, int16x8_t d, int16x8_t sa,
+                                           int16x8_t da)
+{
+    /* one channel of 8 pixels, same formulas as blend_channel() */
+    const int16x8_t full = vdupq_n_s16(0xFF);
+
+    switch(blend) {
+        case VG_LITE_BLEND_NONE:
+        case OPENVG_BLEND_SRC:
+            return s;
+        case VG_LITE_BLEND_DST_OVER:
+        case OPENVG_BLEND_DST_OVER:
+            return vaddq_s16(blend_mul_neon(s, vsubq_s16(full, da)), d);
+        case VG_LITE_BLEND_SRC_IN:
+        case OPENVG_BLEND_SRC_IN:
+            return blend_mul_neon(s, da);
+        case VG_LITE_BLEND_DST_IN:
+        case OPENVG_BLEND_DST_IN:
+            return blend_mul_neon(d, sa);
+        case VG_LITE_BLEND_MULTIPLY:
+        case OPENVG_BLEND_MULTIPLY:
+            return vaddq_s16(vaddq_s16(blend_mul_neon(s, vsubq_s16(full, da)), blend_mul_neon(d, vsubq_s16(full, sa))),
+                             blend_mul_neon(s, d));
+        case VG_LITE_BLEND_SCREEN:
+        case OPENVG_BLEND_SCREEN:
+            return vsubq_s16(vaddq_s16(s, d), blend_mul_neon(s, d));
+        case VG_LITE_BLEND_DARKEN:
+        case OPENVG_BLEND_DARKEN:
+            return vminq_s16(vaddq_s16(s, blend_mul_neon(d, vsubq_s16(full, sa))),
+                             vaddq_s16(d, blend_mul_neon(s, vsubq_s16(full, da))));
+        case VG_LITE_BLEND_LIGHTEN:
+        case OPENVG_BLEND_LIGHTEN:
+            return vmaxq_s16(vaddq_s16(s, blend_mul_neon(d, vsubq_s16(full, sa))),
+                             vaddq_s16(d, blend_mul_neon(s, vsubq_s16(full, da))));
+        case VG_LITE_BLEND_ADDITIVE:
+        case VG_LITE_BLEND_ADDITIVE_LVGL:
+        case OPENVG_BLEND_ADDITIVE:
+            return vaddq_s16(s, d);
+        case VG_LITE_BLEND_SUBTRACT:
+            return blend_mul_neon(d, vsubq_s16(full, sa));
+        case VG_LITE_BLEND_SUBTRACT_LVGL:
+            return vsubq_s16(d, s);
+        case VG_LITE_BLEND_MULTIPLY_LVGL:
+            return vaddq_s16(blend_mul_neon(s, d), blend_mul_neon(d, vsubq_s16(full, sa)));
+        default:
+            return vaddq_s16(s, blend_mul_neon(d, vsubq_s16(full, sa)));
+    }
+}
+
+static inline uint8x8_t blend_lerp_neon(int16x8_t r, int16x8_t d, int16x8_t cov)
+{
+    /* the result is clamped before it is weighted by the coverage */
+    const int16x8_t full = vdupq_n_s16(0xFF);
+    r = vminq_s16(vmaxq_s16(r, vdupq_n_s16(0)), full);
+    return vqmovun_s16(vaddq_s16(blend_mul_neon(r, cov), blend_mul_neon(d, vsubq_s16(full, cov))));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+static inline __m128i blend_mul_sse2(__m128i a, __m128i b)
+{
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i blend_pixels_sse2(vg_lite_blend_t blend, __m128i s, __m128i d)
+{
+    /* two pixels in 16 bit lanes, same formulas as blend_channel() */
+    const __m128i full = _mm_set1_epi16(0xFF);
+    __m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i r;
+
+    switch(blend) {
+        case VG_LITE_BLEND_NONE:
+        case OPENVG_BLEND_SRC:
+            return s;
+        case VG_LITE_BLEND_DST_OVER:
+        case OPENVG_BLEND_DST_OVER:
+            return _mm_add_epi16(blend_mul_sse2(s, _mm_sub_epi16(full, da)), d);
+        case VG_LITE_BLEND_SRC_IN:
+        case OPENVG_BLEND_SRC_IN:
+            return blend_mul_sse2(s, da);
+        case VG_LITE_BLEND_DST_IN:
+        case OPENVG_BLEND_DST_IN:
+            return blend_mul_sse2(d, sa);
+        case VG_LITE_BLEND_MULTIPLY:
+        case OPENVG_BLEND_MULTIPLY:
+            return _mm_add_epi16(_mm_add_epi16(blend_mul_sse2(s, _mm_sub_epi16(full, da)),
+                                               blend_mul_sse2(d, _mm_sub_epi16(full, sa))), blend_mul_sse2(s, d));
+        case VG_LITE_BLEND_SCREEN:
+        case OPENVG_BLEND_SCREEN:
+            return _mm_sub_epi16(_mm_add_epi16(s, d), blend_mul_sse2(s, d));
+        case VG_LITE_BLEND_DARKEN:
+        case OPENVG_BLEND_DARKEN:
+            return _mm_min_epi16(_mm_add_epi16(s, blend_mul_sse2(d, _mm_sub_epi16(full, sa))),
+                                 _mm_add_epi16(d, blend_mul_sse2(s, _mm_sub_epi16(full, da))));
+        case VG_LITE_BLEND_LIGHTEN:
+        case OPENVG_BLEND_LIGHTEN:
+            return _mm_max_epi16(_mm_add_epi16(s, blend_mul_sse2(d, _mm_sub_epi16(full, sa))),
+                                 _mm_add_epi16(d, blend_mul_sse2(s, _mm_sub_epi16(full, da))));
+        case VG_LITE_BLEND_ADDITIVE:
+        case OPENVG_BLEND_ADDITIVE:
+            return _mm_add_epi16(s, d);
+        case VG_LITE_BLEND_SUBTRACT:
+            return blend_mul_sse2(d, _mm_sub_epi16(full, sa));
+        case VG_LITE_BLEND_ADDITIVE_LVGL:
+            r = _mm_add_epi16(s, d);
+            break;
+        case VG_LITE_BLEND_SUBTRACT_LVGL:
+            r = _mm_sub_epi16(d, s);
+            break;
+        case VG_LITE_BLEND_MULTIPLY_LVGL:
+            r = _mm_add_epi16(blend_mul_sse2(s, d), blend_mul_sse2(d, _mm_sub_epi16(full, sa)));
+            break;
+        default:
+            return _mm_add_epi16(s, blend_mul_sse2(d, _mm_sub_epi16(full, sa)));
+    }
+
+    /* the alpha of the LVGL modes is source over */
+    const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    __m128i a = _mm_add_epi16(sa, blend_mul_sse2(da, _mm_sub_epi16(full, sa)));
+    return _mm_or_si128(_mm_andnot_si128(alpha_lanes, r), _mm_and_si128(alpha_lanes, a));
+}
+
+static inline __m128i blend_lerp_sse2(__m128i r, __m128i d, __m128i cov)
+{
+    /* the result is clamped before it is weighted by the coverage */
+    const __m128i full = _mm_set1_epi16(0xFF);
+    r = _mm_min_epi16(_mm_max_epi16(r, _mm_setzero_si128()), full);
+    return _mm_add_epi16(blend_mul_sse2(r, cov), blend_mul_sse2(d, _mm_sub_epi16(full, cov)));
+}
+#endif
+
+static void blend_span(const vg_lite_raster_t * raster, vg_lite_blend_t blend, vg_lite_uint32_t * dest,
+                       const vg_lite_uint32_t * src, const uint8_t * coverage, int32_t len)
+{
+    /**
+     * Every blend mode over a span of premultiplied pixels, the result is mixed with the target
+     * by the coverage when there is one, which leaves the pixels of coverage 0 unchanged.
+     * The global alpha of the target changes the alpha the formulas read, not the one mixed.
+     */
+    vg_lite_global_alpha_t dest_mode = raster->dest_alpha_mode;
+    vg_lite_uint8_t dest_value = raster->dest_alpha_value;
+    int32_t i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const int16x8_t full = vdupq_n_s16(0xFF);
+    bool lvgl = blend_is_lvgl(blend);
+
+    for(; i + 8 <= len; i += 8) {
+        uint8x8x4_t s8 = vld4_u8((const uint8_t *)(src + i));
+        uint8x8x4_t d8 = vld4_u8((const uint8_t *)(dest + i));
+        int16x8_t cov = coverage ? vreinterpretq_s16_u16(vmovl_u8(vld1_u8(coverage + i))) : full;
+        int16x8_t sa = vreinterpretq_s16_u16(vmovl_u8(s8.val[3]));
+        int16x8_t da = vreinterpretq_s16_u16(vmovl_u8(d8.val[3]));
+        uint8x8x4_t out;
+
+        if(dest_mode == VG_LITE_GLOBAL) {
+            da = vdupq_n_s16(dest_value);
+        }
+        else if(dest_mode == VG_LITE_SCALED) {
+            da = blend_mul_neon(da, vdupq_n_s16(dest_value));
+        }
+
+        for(int c = 0; c < 4; c++) {
+            int16x8_t s = vreinterpretq_s16_u16(vmovl_u8(s8.val[c]));
+            int16x8_t d = vreinterpretq_s16_u16(vmovl_u8(d8.val[c]));
+            int16x8_t r = c == 3 && lvgl ? vaddq_s16(sa, blend_mul_neon(da, vsubq_s16(full, sa)))
+                          : blend_channel_neon(blend, s, c == 3 ? da : d, sa, da);
+            out.val[c] = blend_lerp_neon(r, d, cov);
+        }
+
+        vst4_u8((uint8_t *)(dest + i), out);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(0xFF);
+
+    const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i dest_alpha = _mm_set1_epi16(dest_value);
+
+    for(; i + 4 <= len; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+        __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+        __m128i read_lo = d_lo;
+        __m128i read_hi = d_hi;
+
+        if(dest_mode != VG_LITE_NORMAL) {
+            __m128i a_lo = dest_mode == VG_LITE_GLOBAL ? dest_alpha : blend_mul_sse2(d_lo, dest_alpha);
+            __m128i a_hi = dest_mode == VG_LITE_GLOBAL ? dest_alpha : blend_mul_sse2(d_hi, dest_alpha);
+            read_lo = _mm_or_si128(_mm_andnot_si128(alpha_lanes, d_lo), _mm_and_si128(alpha_lanes, a_lo));
+            read_hi = _mm_or_si128(_mm_andnot_si128(alpha_lanes, d_hi), _mm_and_si128(alpha_lanes, a_hi));
+        }
+
+        __m128i r_lo = blend_pixels_sse2(blend, _mm_unpacklo_epi8(s, zero), read_lo);
+        __m128i r_hi = blend_pixels_sse2(blend, _mm_unpackhi_epi8(s, zero), read_hi);
+
+        if(coverage) {
+            /* each coverage byte is spread over the 4 channels of its pixel */
+            __m128i cov = _mm_cvtsi32_si128((int)(coverage[i] | coverage[i + 1] << 8 | coverage[i + 2] << 16
+                                                  | (vg_lite_uint32_t)coverage[i + 3] << 24));
+            cov = _mm_unpacklo_epi8(cov, cov);
+            cov = _mm_unpacklo_epi16(cov, cov);
+            r_lo = blend_lerp_sse2(r_lo, d_lo, _mm_unpacklo_epi8(cov, zero));
+            r_hi = blend_lerp_sse2(r_hi, d_hi, _mm_unpackhi_epi8(cov, zero));
+        }
+        else {
+            r_lo = _mm_min_epi16(_mm_max_epi16(r_lo, zero), full);
+            r_hi = _mm_min_epi16(_mm_max_epi16(r_hi, zero), full);
+        }
+
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(r_lo, r_hi));
+    }
+#endif
+
+    for(; i < len; i++) {
+        vg_lite_uint32_t cov = coverage ? coverage[i] : 0xFF;
+        if(cov == 0) {
+            continue;
+        }
+
+        dest[i] = pixel_blend(blend, src[i], dest[i], pixel_global_alpha(dest[i], dest_mode, dest_value), cov);
+    }
+}
+
+static inline vg_lite_uint32_t raster_blend_pixel(vg_lite_blend_t blend, vg_lite_uint32_t src, vg_lite_uint32_t dest,
+                                                  vg_lite_uint32_t cov)
+{
+    if(blend == VG_LITE_BLEND_NONE) {
+        return cov == 0xFF ? src : pixel_scale(src, cov) + pixel_scale(dest, 0xFF - cov);
+    }
+
+    if(!blend_is_source_over(blend)) {
+        return pixel_blend(blend, src, dest, dest, cov);
+    }
+
+    if(cov != 0xFF) {
+        src = pixel_scale(src, cov);
+    }
+
+    vg_lite_uint32_t src_alpha = A(src);
+    return src_alpha == 0xFF ? src : src + pixel_scale(dest, 0xFF - src_alpha);
+}
+
+static void raster_blend_span(const vg_lite_raster_t * raster, const vg_lite_raster_paint_t * paint,
+                              vg_lite_uint32_t * dest, const uint8_t * coverage, int32_t len, int32_t x, int32_t y)
+{
+    vg_lite_uint32_t color = paint->color;
+
+    if(paint->layer) {
+        uint8_t * out = paint->layer + y * paint->layer_stride + x;
+        vg_lite_uint32_t alpha = A(color);
+
+        for(int32_t i = 0; i < len; i++) {
+            out[i] = alpha == 0xFF ? coverage[i] : mul_div255(coverage[i], alpha);
+        }
+        return;
+    }
+
+    /* the loops below only know the copy and the source over of the target as it is */
+    bool composite = paint->blend != VG_LITE_BLEND_NONE
+                     && (!blend_is_source_over(paint->blend) || raster->dest_alpha_mode != VG_LITE_NORMAL);
+
+    if(paint->sampler) {
+        vg_lite_uint32_t * texels = paint->texels;
+        sampler_fetch_span(paint->sampler, x, y, len, texels);
+
+        if(paint->sampler2) {
+            /* source over is associative, the two images are merged before the target is read */
+            const vg_lite_uint32_t * texels2 = paint->texels2;
+            sampler_fetch_span(paint->sampler2, x, y, len, paint->texels2);
+
+            for(int32_t i = 0; i < len; i++) {
+                vg_lite_uint32_t alpha = A(texels2[i]);
+                texels[i] = alpha == 0xFF ? texels2[i] : texels2[i] + pixel_scale(texels[i], 0xFF - alpha);
+            }
+        }
+
+        if(composite) {
+            blend_span(raster, paint->blend, dest, texels, coverage, len);
+            return;
+        }
+
+        for(int32_t i = 0; i < len; i++) {
+            vg_lite_uint32_t cov = coverage[i];
+            if(cov && (texels[i] || paint->blend == VG_LITE_BLEND_NONE)) {
+                dest[i] = raster_blend_pixel(paint->blend, texels[i], dest[i], cov);
+            }
+        }
+        return;
+    }
+
+    /* the compositor reads the colors from short runs */
+    vg_lite_uint32_t run[64];
+
+    if(paint->ramp) {
+        /* the ramp lookups are scalar, the composited runs are blended by the vector code of blend_span() */
+        int64_t index = paint->index_origin + x * paint->index_x + y * paint->index_y;
+
+        if(paint->index_x != 0 && composite) {
+            for(int32_t i = 0; i < len; i += 64) {
+                int32_t n = MIN(len - i, 64);
+                for(int32_t k = 0; k < n; k++, index += paint->index_x) {
+                    int64_t ramp_index = index >> 16;
+                    run[k] = paint->ramp[CLAMP(ramp_index, 0, paint->ramp_last)];
+                }
+                blend_span(raster, paint->blend, dest + i, run, coverage + i, n);
+            }
+            return;
+        }
+
+        if(paint->index_x != 0) {
+            for(int32_t i = 0; i < len; i++, index += paint->index_x) {
+                vg_lite_uint32_t cov = coverage[i];
+                if(cov) {
+                    int64_t k = index >> 16;
+                    dest[i] = raster_blend_pixel(paint->blend, paint->ramp[CLAMP(k, 0, paint->ramp_last)], dest[i], cov);
+                }
+            }
+            return;
+        }
+
+        /* a vertical gradient has one color per row */
+        int64_t k = index >> 16;
+        color = paint->ramp[CLAMP(k, 0, paint->ramp_last)];
+    }
+
+    if(composite) {
+        int32_t n = MIN(len, 64);
+        for(int32_t i = 0; i < n; i++) {
+            run[i] = color;
+        }
+
+        for(int32_t i = 0; i < len; i += 64) {
+            blend_span(raster, paint->blend, dest + i, run, coverage + i, MIN(len - i, 64));
+        }
+        return;
+    }
+
+    if(paint->blend == VG_LITE_BLEND_NONE) {
+        for(int32_t i = 0; i < len; i++) {
+            vg_lite_uint32_t cov = coverage[i];
+            if(cov == 0xFF) {
+                dest[i] = color;
+            }
+            else if(cov) {
+                dest[i] = pixel_scale(color, cov) + pixel_scale(dest[i], 0xFF - cov);
+            }
+        }
+        return;
+    }
+
+    for(int32_t i = 0; i < len; i++) {
+        vg_lite_uint32_t cov = coverage[i];
+        if(cov == 0) {
+            continue;
+        }
+
+        vg_lite_uint32_t src = cov == 0xFF ? color : pixel_scale(color, cov);
+        vg_lite_uint32_t src_alpha = A(src);
+        dest[i] = src_alpha == 0xFF ? src : src + pixel_scale(dest[i], 0xFF - src_alpha);
+    }
+}
+
+static void raster_output_span(vg_lite_raster_t * raster, const vg_lite_raster_paint_t * paint,
+                               vg_lite_uint32_t * dest, const uint8_t * coverage, int32_t len, int32_t x, int32_t y)
+{
+    /* the enabled mask layer scales the coverage of the draws, it reads as 0 outside of its area */
+    if(raster->mask && !paint->layer) {
+        int32_t start = MAX(x, 0);
+        int32_t end = MIN(x + len, raster->mask_width);
+
+        if(y < 0 || y >= raster->mask_height || start >= end) {
+            return;
+        }
+
+        raster->masked.resize(end - start);
+        uint8_t * masked = raster->masked.data();
+        memcpy(masked, coverage + (start - x), end - start);
+        mask_blend_row(masked, raster->mask + y * raster->mask_stride + start, end - start, VG_LITE_INTERSECT_MASK);
+
+        dest += start - x;
+        coverage = masked;
+        len = end - start;
+        x = start;
+    }
+
+    raster_blend_span(raster, paint, dest, coverage, len, x, y);
+}
+
+static void raster_fill_polygon(vg_lite_raster_t * raster, const vg_lite_polygon_t * polygon, vg_lite_fill_t fill_rule,
+                                vg_lite_uint32_t samples, const vg_lite_ibox_t * clip, const vg_lite_raster_paint_t * paint,
+                                vg_lite_uint32_t * dest, vg_lite_uint32_t stride)
+{
+    LV_ASSERT(samples && (samples & (samples - 1)) == 0);
+
+    /* clamp in float first, the polygon may be far outside of the integer range */
+    const vg_lite_fbox_t * extents = &polygon->extents;
+    const int32_t x_min = (int32_t)(CLAMP(floorf(extents->x_min), (float)clip->x_min, (float)clip->x_max));
+    const int32_t x_max = (int32_t)(CLAMP(ceilf(extents->x_max), (float)clip->x_min, (float)clip->x_max));
+    const int32_t y_min = (int32_t)(CLAMP(floorf(extents->y_min), (float)clip->y_min, (float)clip->y_max));
+    const int32_t y_max = (int32_t)(CLAMP(ceilf(extents->y_max), (float)clip->y_min, (float)clip->y_max));
+
+    if(x_min >= x_max || y_min >= y_max) {
+        return;
+    }
+
+    /* build the edge table, every contour of a fill is implicitly closed */
+    auto & edges = raster->edges;
+    edges.clear();
+
+    for(const auto & contour : polygon->contours) {
+        const vg_lite_fpoint_t * pts = polygon->points.data() + contour.begin;
+
+        for(vg_lite_uint32_t i = 0; i < contour.count; i++) {
+            const vg_lite_fpoint_t * p0 = &pts[i];
+            const vg_lite_fpoint_t * p1 = &pts[i + 1 == contour.count ? 0 : i + 1];
+
+            if(p0->y == p1->y) {
+                continue;
+            }
+
+            vg_lite_edge_t edge;
+            edge.dir = 1;
+            if(p0->y > p1->y) {
+                std::swap(p0, p1);
+                edge.dir = -1;
+            }
+
+            /* only the edges crossing the clipped rows affect the winding */
+            if(p1->y <= y_min || p0->y >= y_max) {
+                continue;
+            }
+
+            edge.x = p0->x;
+            edge.y_top = p0->y;
+            edge.y_bottom = p1->y;
+            edge.slope = (p1->x - p0->x) / (p1->y - p0->y);
+            edges.push_back(edge);
+        }
+    }
+
+    if(edges.empty()) {
+        return;
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const vg_lite_edge_t & a, const vg_lite_edge_t & b) {
+        return a.y_top < b.y_top;
+    });
+
+    /* coverage is accumulated in 1/256 of a pixel per sub-scanline */
+    const int32_t width = x_max - x_min;
+    const vg_lite_float_t fwidth = (vg_lite_float_t)width;
+    vg_lite_uint32_t shift = 8;
+    while((1U << (shift - 8)) < samples) {
+        shift++;
+    }
+
+    const int32_t full = (int32_t)(1U << shift);
+    const vg_lite_float_t step = 1.0f / samples;
+
+    raster->cells.assign(width + 2, 0);
+    raster->partial.assign(width + 2, 0);
+    raster->coverage.resize(width);
+    raster->active.clear();
+
+    int32_t * cells = raster->cells.data();
+    int32_t * partial = raster->partial.data();
+    uint8_t * coverage = raster->coverage.data();
+    auto & active = raster->active;
+    auto & crossings = raster->crossings;
+    size_t next_edge = 0;
+
+    for(int32_t y = y_min; y < y_max; y++) {
+        int32_t span_min = width;
+        int32_t span_max = 0;
+
+        for(vg_lite_uint32_t s = 0; s < samples; s++) {
+            vg_lite_float_t sy = y + (s + 0.5f) * step;
+
+            while(next_edge < edges.size() && edges[next_edge].y_top <= sy) {
+                active.push_back((vg_lite_uint32_t)next_edge++);
+            }
+
+            /* retire the finished edges and intersect the others with the sub-scanline */
+            crossings.clear();
+            size_t count = 0;
+            for(size_t i = 0; i < active.size(); i++) {
+                const vg_lite_edge_t * edge = &edges[active[i]];
+                if(edge->y_bottom <= sy) {
+                    continue;
+                }
+
+                active[count++] = active[i];
+                vg_lite_crossing_t crossing = { edge->x + (sy - edge->y_top) * edge->slope, edge->dir };
+                crossings.push_back(crossing);
+            }
+            active.resize(count);
+
+            std::sort(crossings.begin(), crossings.end(), [](const vg_lite_crossing_t & a, const vg_lite_crossing_t & b) {
+                return a.x < b.x;
+            });
+
+            int32_t winding = 0;
+            for(size_t i = 0; i + 1 < crossings.size(); i++) {
+                winding += crossings[i].dir;
+
+                bool inside = fill_rule == VG_LITE_FILL_EVEN_ODD ? (winding & 1) : winding != 0;
+                if(!inside) {
+                    continue;
+                }
+
+                vg_lite_float_t xa = CLAMP(crossings[i].x - x_min, 0.0f, fwidth);
+                vg_lite_float_t xb = CLAMP(crossings[i + 1].x - x_min, 0.0f, fwidth);
+                if(xa >= xb) {
+                    continue;
+                }
+
+                int32_t ia;
+                int32_t ib;
+
+                if(samples == 1) {
+                    /* no anti-aliasing, take the pixels whose center is inside the span */
+                    ia = (int32_t)ceilf(xa - 0.5f);
+                    ib = (int32_t)ceilf(xb - 0.5f);
+                    if(ia >= ib) {
+                        continue;
+                    }
+
+                    cells[ia] += full;
+                    cells[ib] -= full;
+                }
+                else {
+                    int32_t fa = (int32_t)(xa * 256);
+                    int32_t fb = (int32_t)(xb * 256);
+                    ia = fa >> 8;
+                    ib = fb >> 8;
+
+                    if(ia == ib) {
+                        partial[ia] += fb - fa;
+                    }
+                    else {
+                        partial[ia] += 256 - (fa & 0xFF);
+                        cells[ia + 1] += 256;
+                        cells[ib] -= 256;
+                        partial[ib] += fb & 0xFF;
+                    }
+
+                    ib++;
+                }
+
+                span_min = MIN(span_min, ia);
+                span_max = MAX(span_max, ib);
+            }
+        }
+
+        if(span_min >= span_max) {
+            continue;
+        }
+
+        span_max = MIN(span_max, width);
+
+        int32_t run = 0;
+        for(int32_t x = span_min; x < span_max; x++) {
+            run += cells[x];
+            int32_t acc = run + partial[x];
+            cells[x] = 0;
+            partial[x] = 0;
+            coverage[x - span_min] = acc >= full ? 0xFF : (uint8_t)((acc * 0xFF) >> shift);
+        }
+
+        cells[span_max] = 0;
+        partial[span_max] = 0;
+
+        raster_output_span(raster, paint, dest ? dest + y * stride + x_min + span_min : nullptr, coverage,
+                           span_max - span_min, x_min + span_min, y);
+    }
+}
+
+static bool path_get_rrect(const vg_lite_path_t * path, vg_lite_fbox_t * box, vg_lite_float_t * radius)
+{
+    typedef struct {
+        vg_lite_fpoint_t from;
+        vg_lite_fpoint_t c1;
+        vg_lite_fpoint_t c2;
+        vg_lite_fpoint_t to;
+        bool is_curve;
+    } segment_t;
+
+    /* a rounded rectangle is made of 4 sides and 4 corners at most */
+    const int max_segments = 9;
+    segment_t segments[max_segments + 1];
+    int count = 0;
+
+    uint8_t fmt_len = vlc_format_len(path->format);
+
+    /* move + 4 * line + 4 * cubic + close + end */
+    if(path->path_length > (vg_lite_uint32_t)(3 + 4 * 3 + 4 * 7 + 2) * fmt_len) {
+        return false;
+    }
+
+    uint8_t * cur = (uint8_t *)path->path;
+    uint8_t * end = cur + path->path_length;
+
+    vg_lite_fpoint_t start = { 0, 0 };
+    vg_lite_fpoint_t last = { 0, 0 };
+    bool has_move = false;
+    bool closed = false;
+
+    while(cur < end && !closed) {
+        uint8_t op_code = VLC_GET_OP_CODE(cur);
+        uint8_t arg_len = vlc_op_arg_len(op_code);
+        cur += fmt_len;
+
+        switch(op_code) {
+            case VLC_OP_MOVE: {
+                    /* a single subpath only */
+                    if(has_move) {
+                        return false;
+                    }
+
+                    float x = VLC_GET_ARG(cur, 0);
+                    float y = VLC_GET_ARG(cur, 1);
+                    start.x = last.x = x;
+                    start.y = last.y = y;
+                    has_move = true;
+                }
+                break;
+
+            case VLC_OP_LINE:
+            case VLC_OP_CUBIC: {
+                    if(!has_move || count == max_segments) {
+                        return false;
+                    }
+
+                    segment_t * seg = &segments[count++];
+                    seg->from = last;
+                    seg->is_curve = op_code == VLC_OP_CUBIC;
+
+                    int i = 0;
+                    if(seg->is_curve) {
+                        float cx1 = VLC_GET_ARG(cur, 0);
+                        float cy1 = VLC_GET_ARG(cur, 1);
+                        float cx2 = VLC_GET_ARG(cur, 2);
+                        float cy2 = VLC_GET_ARG(cur, 3);
+                        seg->c1.x = cx1;
+                        seg->c1.y = cy1;
+                        seg->c2.x = cx2;
+                        seg->c2.y = cy2;
+                        i = 4;
+                    }
+
+                    float x = VLC_GET_ARG(cur, i);
+                    float y = VLC_GET_ARG(cur, i + 1);
+                    seg->to.x = last.x = x;
+                    seg->to.y = last.y = y;
+                }
+                break;
+
+            case VLC_OP_CLOSE:
+            case VLC_OP_END:
+                closed = true;
+                break;
+
+            default:
+                return false;
+        }
+
+        cur += arg_len * fmt_len;
+    }
+
+    /* ignore anything after the first subpath, but only if it draws nothing */
+    while(cur < end) {
+        uint8_t op_code = VLC_GET_OP_CODE(cur);
+        if(op_code != VLC_OP_END && op_code != VLC_OP_CLOSE) {
+            return false;
+        }
+        cur += (1 + vlc_op_arg_len(op_code)) * fmt_len;
+    }
+
+    if(count < 3) {
+        return false;
+    }
+
+    vg_lite_fbox_t hull = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+    fbox_add_point(&hull, start.x, start.y);
+    for(int i = 0; i < count; i++) {
+        fbox_add_point(&hull, segments[i].to.x, segments[i].to.y);
+    }
+
+    vg_lite_float_t eps = 1e-3f * (1 + (MAX(hull.x_max - hull.x_min, hull.y_max - hull.y_min)));
+
+    /* the fill closes the outline implicitly */
+    if(fabsf(last.x - start.x) > eps || fabsf(last.y - start.y) > eps) {
+        segment_t * seg = &segments[count++];
+        seg->from = last;
+        seg->to = start;
+        seg->is_curve = false;
+    }
+
+    auto on_edge_x = [&](float x) {
+        return fabsf(x - hull.x_min) <= eps || fabsf(x - hull.x_max) <= eps;
+    };
+    auto on_edge_y = [&](float y) {
+        return fabsf(y - hull.y_min) <= eps || fabsf(y - hull.y_max) <= eps;
+    };
+
+    vg_lite_float_t r = 0;
+    int corners = 0;
+    uint8_t corner_mask = 0;
+    bool turns_on_corners = true;
+    vg_lite_float_t area = 0;
+
+    for(int i = 0; i < count; i++) {
+        const segment_t * seg = &segments[i];
+        vg_lite_float_t dx = seg->to.x - seg->from.x;
+        vg_lite_float_t dy = seg->to.y - seg->from.y;
+
+        /* every on-curve point lies on the border */
+        if(!on_edge_x(seg->to.x) && !on_edge_y(seg->to.y)) {
+            return false;
+        }
+
+        if(!on_edge_x(seg->to.x) || !on_edge_y(seg->to.y)) {
+            turns_on_corners = false;
+        }
+
+        area += seg->from.x * seg->to.y - seg->to.x * seg->from.y;
+
+        if(!seg->is_curve) {
+            if(fabsf(dx) <= eps && fabsf(dy) <= eps) {
+                /* zero length side of a pill shape */
+                continue;
+            }
+
+            /* sides run along the border */
+            if(fabsf(dx) <= eps) {
+                if(!on_edge_x(seg->from.x)) {
+                    return false;
+                }
+            }
+            else if(fabsf(dy) <= eps) {
+                if(!on_edge_y(seg->from.y)) {
+                    return false;
+                }
+            }
+            else {
+                return false;
+            }
+
+            continue;
+        }
+
+        /* a quarter circle approximation, turning around a corner of the hull */
+        vg_lite_float_t cr = fabsf(dx);
+        if(cr <= eps || fabsf(fabsf(dy) - cr) > eps) {
+            return false;
+        }
+
+        if(corners && fabsf(r - cr) > eps) {
+            return false;
+        }
+        r = cr;
+
+        vg_lite_fpoint_t corner;
+        vg_lite_float_t k1;
+        vg_lite_float_t k2;
+
+        if(fabsf(seg->c1.y - seg->from.y) <= eps && fabsf(seg->c2.x - seg->to.x) <= eps) {
+            /* leaves horizontally, arrives vertically */
+            corner.x = seg->to.x;
+            corner.y = seg->from.y;
+            k1 = fabsf(seg->c1.x - seg->from.x);
+            k2 = fabsf(seg->c2.y - seg->to.y);
+        }
+        else if(fabsf(seg->c1.x - seg->from.x) <= eps && fabsf(seg->c2.y - seg->to.y) <= eps) {
+            /* leaves vertically, arrives horizontally */
+            corner.x = seg->from.x;
+            corner.y = seg->to.y;
+            k1 = fabsf(seg->c1.y - seg->from.y);
+            k2 = fabsf(seg->c2.x - seg->to.x);
+        }
+        else {
+            return false;
+        }
+
+        /* control points at ~0.552 r make a circular arc, anything else is a different shape */
+        if(k1 < 0.54f * cr || k1 > 0.56f * cr || k2 < 0.54f * cr || k2 > 0.56f * cr) {
+            return false;
+        }
+
+        if(!on_edge_x(corner.x) || !on_edge_y(corner.y)) {
+            return false;
+        }
+
+        uint8_t bit = (uint8_t)(1 << ((fabsf(corner.x - hull.x_min) <= eps ? 0 : 1)
+                                      + (fabsf(corner.y - hull.y_min) <= eps ? 0 : 2)));
+        if(corner_mask & bit) {
+            return false;
+        }
+
+        corner_mask |= bit;
+        corners++;
+    }
+
+    if(corners == 0) {
+        /* a plain rectangle turns on the corners of the hull and encloses all of it */
+        vg_lite_float_t hull_area = (hull.x_max - hull.x_min) * (hull.y_max - hull.y_min);
+        if(!turns_on_corners || fabsf(fabsf(area / 2) - hull_area) > eps * (1 + hull_area)) {
+            return false;
+        }
+    }
+    else if(corners != 4 || r * 2 > hull.x_max - hull.x_min + eps || r * 2 > hull.y_max - hull.y_min + eps) {
+        return false;
+    }
+
+    *box = hull;
+    *radius = r;
+    return true;
+}
+
+static inline vg_lite_float_t span_overlap(vg_lite_float_t x, vg_lite_float_t x_min, vg_lite_float_t x_max)
+{
+    /* covered length of the pixel [x, x + 1] */
+    vg_lite_float_t a = MAX(x, x_min);
+    vg_lite_float_t b = MIN(x + 1, x_max);
+    return b > a ? b - a : 0;
+}
+
+static void raster_fill_rrect(vg_lite_raster_t * raster, const vg_lite_fbox_t * box, vg_lite_float_t radius,
+                              bool anti_alias, const vg_lite_ibox_t * clip, const vg_lite_raster_paint_t * paint,
+                              vg_lite_uint32_t * dest, vg_lite_uint32_t stride)
+{
+    const int32_t x_min = (int32_t)(CLAMP(floorf(box->x_min), (float)clip->x_min, (float)clip->x_max));
+    const int32_t x_max = (int32_t)(CLAMP(ceilf(box->x_max), (float)clip->x_min, (float)clip->x_max));
+    const int32_t y_min = (int32_t)(CLAMP(floorf(box->y_min), (float)clip->y_min, (float)clip->y_max));
+    const int32_t y_max = (int32_t)(CLAMP(ceilf(box->y_max), (float)clip->y_min, (float)clip->y_max));
+
+    if(x_min >= x_max || y_min >= y_max) {
+        return;
+    }
+
+    const int32_t width = x_max - x_min;
+
+    /* coverage of the columns for a fully covered row, exact for sub-pixel borders */
+    raster->coverage.resize(width);
+    raster->row_coverage.resize(width);
+    uint8_t * columns = raster->coverage.data();
+    uint8_t * row = raster->row_coverage.data();
+
+    for(int32_t x = x_min; x < x_max; x++) {
+        vg_lite_float_t cov;
+        if(anti_alias) {
+            cov = span_overlap((vg_lite_float_t)x, box->x_min, box->x_max);
+        }
+        else {
+            cov = x + 0.5f >= box->x_min && x + 0.5f < box->x_max ? 1.0f : 0.0f;
+        }
+
+        columns[x - x_min] = (uint8_t)(cov * 0xFF + 0.5f);
+    }
+
+    /* the rows and columns of the corner areas */
+    const vg_lite_float_t inner_x_min = box->x_min + radius;
+    const vg_lite_float_t inner_x_max = box->x_max - radius;
+    const vg_lite_float_t inner_y_min = box->y_min + radius;
+    const vg_lite_float_t inner_y_max = box->y_max - radius;
+
+    for(int32_t y = y_min; y < y_max; y++) {
+        vg_lite_float_t cy = y + 0.5f;
+        vg_lite_float_t row_cov;
+        if(anti_alias) {
+            row_cov = span_overlap((vg_lite_float_t)y, box->y_min, box->y_max);
+        }
+        else {
+            row_cov = cy >= box->y_min && cy < box->y_max ? 1.0f : 0.0f;
+        }
+
+        if(row_cov <= 0) {
+            continue;
+        }
+
+        vg_lite_uint32_t * dest_row = dest ? dest + y * stride + x_min : nullptr;
+        bool in_corner_rows = radius > 0 && (y < inner_y_min || y + 1 > inner_y_max);
+
+        if(row_cov >= 1 && !in_corner_rows) {
+            raster_output_span(raster, paint, dest_row, columns, width, x_min, y);
+            continue;
+        }
+
+        vg_lite_uint32_t row_alpha = (vg_lite_uint32_t)(row_cov * 0xFF + 0.5f);
+        for(int32_t i = 0; i < width; i++) {
+            row[i] = (uint8_t)UDIV255(columns[i] * row_alpha);
+        }
+
+        if(in_corner_rows) {
+            /* center of the corner circle, for the pixels next to the rounded part */
+            vg_lite_float_t center_y = cy < inner_y_min ? inner_y_min : inner_y_max;
+            vg_lite_float_t dy = cy < inner_y_min || cy > inner_y_max ? cy - center_y : 0;
+
+            for(int32_t x = x_min; x < x_max; x++) {
+                vg_lite_float_t cx = x + 0.5f;
+                if(x >= inner_x_min && x + 1 <= inner_x_max) {
+                    continue;
+                }
+
+                vg_lite_float_t center_x = cx < inner_x_min ? inner_x_min : inner_x_max;
+                vg_lite_float_t dx = cx < inner_x_min || cx > inner_x_max ? cx - center_x : 0;
+                vg_lite_float_t dist = point_length(dx, dy);
+
+                /* distance to the arc gives the coverage of the edge pixels */
+                vg_lite_float_t cov;
+                if(anti_alias) {
+                    cov = CLAMP(radius + 0.5f - dist, 0.0f, 1.0f);
+                }
+                else {
+                    cov = dist <= radius ? 1.0f : 0.0f;
+                }
+
+                uint8_t cov8 = (uint8_t)(cov * 0xFF + 0.5f);
+                uint8_t * px = &row[x - x_min];
+                *px = MIN(*px, cov8);
+            }
+        }
+
+        raster_output_span(raster, paint, dest_row, row, width, x_min, y);
+    }
+}
+
+static Result raster_draw_rrect(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                                const vg_lite_matrix_t * matrix, const vg_lite_raster_paint_t * paint)
+{
+    /* the coverage is the exact overlap of the box and the rows, at any quality */
+    if(path->path_type != VG_LITE_DRAW_ZERO && path->path_type != VG_LITE_DRAW_FILL_PATH) {
+        return Result::NonSupport;
+    }
+
+    if(!matrix_is_axis_aligned(matrix)) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_fbox_t box;
+    vg_lite_float_t radius;
+    if(!path_get_rrect(path, &box, &radius)) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_fbox_t bbox = {
+        path->bounding_box[0],
+        path->bounding_box[1],
+        path->bounding_box[2],
+        path->bounding_box[3]
+    };
+
+    if(!fbox_contains(&bbox, &box)) {
+        if(radius > 0) {
+            /* the bounding box would cut the corners */
+            return Result::NonSupport;
+        }
+
+        box.x_min = MAX(box.x_min, bbox.x_min);
+        box.y_min = MAX(box.y_min, bbox.y_min);
+        box.x_max = MIN(box.x_max, bbox.x_max);
+        box.y_max = MIN(box.y_max, bbox.y_max);
+        if(fbox_is_empty(&box)) {
+            return Result::Success;
+        }
+    }
+
+    if(matrix) {
+        vg_lite_float_t sx = point_length(matrix->m[0][0], matrix->m[1][0]);
+        vg_lite_float_t sy = point_length(matrix->m[0][1], matrix->m[1][1]);
+
+        /* circles must stay circles */
+        if(radius > 0 && fabsf(sx - sy) > 1e-3f * (MAX(sx, sy))) {
+            return Result::NonSupport;
+        }
+
+        vg_lite_fpoint_t p0 = { box.x_min, box.y_min };
+        vg_lite_fpoint_t p1 = { box.x_max, box.y_max };
+        p0 = matrix_transform_point(matrix, &p0);
+        p1 = matrix_transform_point(matrix, &p1);
+
+        box = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+        fbox_add_point(&box, p0.x, p0.y);
+        fbox_add_point(&box, p1.x, p1.y);
+        radius *= sx;
+    }
+
+    /* the rasterizer clips to a single rectangle */
+    vg_lite_ibox_t clip;
+    if(!scissor_get_clip(ctx, target, &clip)) {
+        return Result::NonSupport;
+    }
+
+    /* the paints pushed before must land first where they overlap */
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, &box));
+
+    raster_fill_rrect(&ctx->raster, &box, radius, quality_tier_get(path->quality)->samples > 1, &clip, paint,
+                      (vg_lite_uint32_t *)ctx->tvg_target_buffer, ctx->tvg_target_stride);
+
+    ctx->target_dirty = true;
+    return Result::Success;
+}
+
+static Result raster_draw_path(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                               vg_lite_fill_t fill_rule, const vg_lite_matrix_t * matrix,
+                               const vg_lite_raster_paint_t * paint)
+{
+#if LV_VG_LITE_THORVG_QUALITY_TIERS
+    bool tiered = path->quality == VG_LITE_MEDIUM || path->quality == VG_LITE_LOW;
+#else
+    bool tiered = false;
+#endif
+
+    /**
+     * HIGH and UPPER keep the full precision of thorvg, which has no wrapped image paint.
+     * The span compositor blends the paints thorvg could only composite afterwards in place.
+     */
+    bool composited = ctx->raster.mask || !blend_is_native(paint->blend)
+                      || ctx->raster.dest_alpha_mode != VG_LITE_NORMAL;
+    if(!tiered && !paint->sampler && !composited) {
+        return Result::NonSupport;
+    }
+
+    /* the outline of strokes is generated by thorvg */
+    if(path->path_type != VG_LITE_DRAW_ZERO && path->path_type != VG_LITE_DRAW_FILL_PATH) {
+        return Result::NonSupport;
+    }
+
+    /* the outline is flattened for a single scale */
+    if(matrix_has_perspective(matrix)) {
+        return Result::NonSupport;
+    }
+
+    const vg_lite_quality_tier_t * tier = quality_tier_get(path->quality);
+    const vg_lite_lod_t * lod = path_get_lod(ctx, path, matrix);
+
+    if(lod->polygon.points.empty()) {
+        return Result::Success;
+    }
+
+    vg_lite_polygon_t * polygon = &ctx->polygon;
+    polygon_transform(polygon, &lod->polygon, matrix);
+
+    /* the rasterizer clips to a single rectangle */
+    vg_lite_ibox_t clip;
+    if(!scissor_get_clip(ctx, target, &clip)) {
+        return Result::NonSupport;
+    }
+
+    if(!path_clip_to_bbox(path, matrix, polygon, &clip)) {
+        return Result::NonSupport;
+    }
+
+    /* the paints pushed before must land first where they overlap */
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, &polygon->extents));
+
+    raster_fill_polygon(&ctx->raster, polygon, fill_rule, tier->samples, &clip, paint,
+                        (vg_lite_uint32_t *)ctx->tvg_target_buffer, ctx->tvg_target_stride);
+
+    ctx->target_dirty = true;
+    return Result::Success;
+}
+
+static bool path_clip_to_bbox(const vg_lite_path_t * path, const vg_lite_matrix_t * matrix,
+                              const vg_lite_polygon_t * polygon, vg_lite_ibox_t * clip)
+{
+    /* the hardware clips the path to its bounding box, false when that needs a rotated clip */
+    vg_lite_fbox_t bbox = {
+        path->bounding_box[0],
+        path->bounding_box[1],
+        path->bounding_box[2],
+        path->bounding_box[3]
+    };
+
+    bool bbox_is_unbounded = math_equal(bbox.x_min, -FLT_MAX) && math_equal(bbox.y_min, -FLT_MAX)
+                             && math_equal(bbox.x_max, FLT_MAX) && math_equal(bbox.y_max, FLT_MAX);
+
+    if(bbox_is_unbounded || fbox_contains(&bbox, &polygon->path_extents)) {
+        return true;
+    }
+
+    if(!matrix_is_axis_aligned(matrix)) {
+        return false;
+    }
+
+    vg_lite_fpoint_t p0 = { bbox.x_min, bbox.y_min };
+    vg_lite_fpoint_t p1 = { bbox.x_max, bbox.y_max };
+    if(matrix) {
+        p0 = matrix_transform_point(matrix, &p0);
+        p1 = matrix_transform_point(matrix, &p1);
+    }
+
+    vg_lite_float_t x_min = roundf(MIN(p0.x, p1.x));
+    vg_lite_float_t y_min = roundf(MIN(p0.y, p1.y));
+    vg_lite_float_t x_max = roundf(MAX(p0.x, p1.x));
+    vg_lite_float_t y_max = roundf(MAX(p0.y, p1.y));
+
+    clip->x_min = (int32_t)(CLAMP(x_min, (float)clip->x_min, (float)clip->x_max));
+    clip->y_min = (int32_t)(CLAMP(y_min, (float)clip->y_min, (float)clip->y_max));
+    clip->x_max = (int32_t)(CLAMP(x_max, (float)clip->x_min, (float)clip->x_max));
+    clip->y_max = (int32_t)(CLAMP(y_max, (float)clip->y_min, (float)clip->y_max));
+    return true;
+}
+
+static vg_lite_error_t mask_render_path(vg_lite_ctx * ctx, vg_lite_buffer_t * masklayer,
+                                        vg_lite_mask_operation_t operation, const vg_lite_path_t * path,
+                                        vg_lite_fill_t fill_rule, vg_lite_color_t color,
+                                        const vg_lite_matrix_t * matrix)
+{
+    /**
+     * The coverage of the path times the alpha of the color is rendered into a scratch as
+     * large as its bounds, then blended into the mask, the rest of it has a coverage of 0.
+     */
+    int32_t mask_width = masklayer->width;
+    int32_t mask_height = masklayer->height;
+    uint8_t * mask = (uint8_t *)masklayer->memory;
+
+    if(operation == VG_LITE_CLEAR_MASK || operation == VG_LITE_FILL_MASK) {
+        for(int32_t y = 0; y < mask_height; y++) {
+            mask_blend_row(mask + y * masklayer->stride, nullptr, mask_width, operation);
+        }
+        return VG_LITE_SUCCESS;
+    }
+
+    /* the outline of strokes is generated by thorvg */
+    if(path->path_type != VG_LITE_DRAW_ZERO && path->path_type != VG_LITE_DRAW_FILL_PATH) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    if(matrix_has_perspective(matrix)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_ibox_t box = { 0, 0, mask_width, mask_height };
+    vg_lite_polygon_t * polygon = &ctx->polygon;
+    const vg_lite_lod_t * lod = path_get_lod(ctx, path, matrix);
+
+    if(lod->polygon.points.empty()) {
+        box.x_max = box.x_min;
+    }
+    else {
+        polygon_transform(polygon, &lod->polygon, matrix);
+
+        if(!path_clip_to_bbox(path, matrix, polygon, &box)) {
+            return VG_LITE_NOT_SUPPORT;
+        }
+
+        box.x_min = MAX(box.x_min, (int32_t)floorf(polygon->extents.x_min));
+        box.y_min = MAX(box.y_min, (int32_t)floorf(polygon->extents.y_min));
+        box.x_max = MIN(box.x_max, (int32_t)ceilf(polygon->extents.x_max));
+        box.y_max = MIN(box.y_max, (int32_t)ceilf(polygon->extents.y_max));
+    }
+
+    int32_t width = MAX(box.x_max - box.x_min, 0);
+    int32_t height = MAX(box.y_max - box.y_min, 0);
+    if(width == 0 || height == 0) {
+        box = { 0, 0, 0, 0 };
+        width = height = 0;
+    }
+
+    auto & coverage = ctx->mask_coverage;
+    coverage.assign(width * height, 0);
+
+    if(width > 0) {
+        /* the scratch starts at the corner of the bounds */
+        for(auto & p : polygon->points) {
+            p.x -= box.x_min;
+            p.y -= box.y_min;
+        }
+        polygon->extents = { polygon->extents.x_min - box.x_min, polygon->extents.y_min - box.y_min,
+                             polygon->extents.x_max - box.x_min, polygon->extents.y_max - box.y_min
+                           };
+
+        vg_lite_ibox_t clip = { 0, 0, width, height };
+        vg_lite_raster_paint_t paint = {
+            color_premultiply(color), VG_LITE_BLEND_NONE, nullptr, 0, 0, 0, 0,
+            nullptr, nullptr, nullptr, nullptr, coverage.data(), width
+        };
+
+        raster_fill_polygon(&ctx->raster, polygon, fill_rule, quality_tier_get(path->quality)->samples, &clip, &paint,
+                            nullptr, 0);
+    }
+
+    /* the union and the subtraction of a coverage of 0 leave the mask as it is */
+    bool clear_outside = operation == VG_LITE_SET_MASK || operation == VG_LITE_INTERSECT_MASK;
+
+    for(int32_t y = 0; y < mask_height; y++) {
+        uint8_t * row = mask + y * masklayer->stride;
+
+        if(y < box.y_min || y >= box.y_max) {
+            if(clear_outside) {
+                memset(row, 0, mask_width);
+            }
+            continue;
+        }
+
+        if(clear_outside) {
+            memset(row, 0, box.x_min);
+            memset(row + box.x_max, 0, mask_width - box.x_max);
+        }
+
+        mask_blend_row(row + box.x_min, coverage.data() + (y - box.y_min) * width, width, operation);
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+static Result raster_draw_grad(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                               vg_lite_fill_t fill_rule, const vg_lite_matrix_t * matrix,
+                               const vg_lite_linear_gradient_t * grad, vg_lite_blend_t blend)
+{
+    /* the ramp is premultiplied by vg_lite_update_grad() */
+    const vg_lite_fill_cache_t * cache = fill_cache_find(ctx, grad, grad_signature);
+    if(!cache || cache->ramp.empty()) {
+        return Result::NonSupport;
+    }
+
+    if(matrix_has_perspective(matrix) || matrix_has_perspective(&grad->matrix)) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_matrix_t inverse;
+    if(vg_lite_matrix_inverse(&inverse, matrix) != VG_LITE_SUCCESS) {
+        return Result::InvalidArguments;
+    }
+
+    /**
+     * Same as the thorvg fill: the ramp runs over 256 units of the gradient x axis,
+     * the pixels are projected on it in path space.
+     */
+    const vg_lite_matrix_t * m = &grad->matrix;
+    vg_lite_float_t dx = inverse.m[0][0] * m->m[0][0] + inverse.m[0][1] * m->m[1][0];
+    vg_lite_float_t dy = inverse.m[1][0] * m->m[0][0] + inverse.m[1][1] * m->m[1][0];
+    vg_lite_float_t len2 = dx * dx + dy * dy;
+
+    if(len2 < FLT_EPSILON) {
+        return Result::NonSupport;
+    }
+
+    /* 16.16 ramp index per device pixel, the stops 0..255 are the texels of the ramp */
+    vg_lite_float_t scale = 255.0f / 256.0f * 65536.0f / len2;
+    vg_lite_float_t kx = (inverse.m[0][0] * dx + inverse.m[1][0] * dy) * scale;
+    vg_lite_float_t ky = (inverse.m[0][1] * dx + inverse.m[1][1] * dy) * scale;
+    vg_lite_float_t origin = (0.5f - m->m[0][2]) * kx + (0.5f - m->m[1][2]) * ky + 32768.0f;
+
+    vg_lite_raster_paint_t paint;
+    paint.color = 0;
+    paint.blend = blend;
+    paint.ramp = cache->ramp.data();
+    paint.ramp_last = (int32_t)cache->ramp.size() - 1;
+    paint.index_x = (int64_t)kx;
+    paint.index_y = (int64_t)ky;
+    paint.index_origin = (int64_t)origin;
+    paint.sampler = nullptr;
+    paint.texels = nullptr;
+    paint.sampler2 = nullptr;
+    paint.texels2 = nullptr;
+    paint.layer = nullptr;
+    paint.layer_stride = 0;
+
+    Result raster_res = raster_draw_rrect(ctx, target, path, matrix, &paint);
+    if(raster_res == Result::NonSupport) {
+        raster_res = raster_draw_path(ctx, target, path, fill_rule, matrix, &paint);
+    }
+
+    return raster_res;
+}
+
+static bool decode_indexed_line(
+    vg_lite_buffer_format_t color_format,
+    const vg_lite_uint32_t * palette,
+    int32_t x, int32_t y,
+    int32_t w_px, uint32_t stride, const uint8_t * in, vg_lite_uint32_t * out)
+{
+    uint8_t px_size;
+    uint16_t mask;
+
+    in += stride * y; /*First pixel*/
+    out += w_px * y;
+
+    int8_t shift = 0;
+    switch(color_format) {
+        case VG_LITE_INDEX_1:
+            px_size = 1;
+            in += x / 8; /*8pixel per byte*/
+            shift = 7 - (x & 0x7);
+            break;
+        case VG_LITE_INDEX_2:
+            px_size = 2;
+            in += x / 4; /*4pixel per byte*/
+            shift = 6 - 2 * (x & 0x3);
+            break;
+        case VG_LITE_INDEX_4:
+            px_size = 4;
+            in += x / 2; /*2pixel per byte*/
+            shift = 4 - 4 * (x & 0x1);
+            break;
+        case VG_LITE_INDEX_8:
+            px_size = 8;
+            in += x;
+            shift = 0;
+            break;
+        default:
+            LV_ASSERT(false);
+            return false;
+    }
+
+    mask = (1 << px_size) - 1; /*E.g. px_size = 2; mask = 0x03*/
+
+    int32_t i;
+    for(i = 0; i < w_px; i++) {
+        uint8_t val_act = (*in >> shift) & mask;
+        out[i] = palette[val_act];
+
+        shift -= px_size;
+        if(shift < 0) {
+            shift = 8 - px_size;
+            in++;
+        }
+    }
+    return true;
+}
+
+static void color_key_apply(const vg_lite_color_key_t * keys, vg_lite_uint32_t * pixels, vg_lite_uint32_t count)
+{
+    /**
+     * A pixel with its RGB in the range of an enabled key takes the alpha of that key.
+     * The keys are tried from the lowest priority up and the last match wins, which leaves key 0 on top.
+     * The alpha lane of a range is 0 ~ 255 so that only the RGB lanes decide the match.
+     */
+    vg_lite_uint32_t low[4];
+    vg_lite_uint32_t high[4];
+    vg_lite_uint32_t alpha[4];
+    int key_count = 0;
+
+    for(int k = 3; k >= 0; k--) {
+        const vg_lite_color_key_t * key = &keys[k];
+        if(!key->enable) {
+            continue;
+        }
+
+        low[key_count] = (vg_lite_uint32_t)key->low_r << 16 | (vg_lite_uint32_t)key->low_g << 8 | key->low_b;
+        high[key_count] = 0xFF000000 | (vg_lite_uint32_t)key->hign_r << 16 | (vg_lite_uint32_t)key->hign_g << 8
+                          | key->hign_b;
+        alpha[key_count] = (vg_lite_uint32_t)key->alpha << 24;
+        key_count++;
+    }
+
+    vg_lite_uint32_t i = 0;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint32x4_t rgb_mask = vdupq_n_u32(0x00FFFFFF);
+    const uint32x4_t ones = vdupq_n_u32(0xFFFFFFFF);
+
+    for(; i + 4 <= count; i += 4) {
+        uint32x4_t px = vld1q_u32(pixels + i);
+        uint8x16_t px8 = vreinterpretq_u8_u32(px);
+        uint32x4_t rgb = vandq_u32(px, rgb_mask);
+
+        for(int k = 0; k < key_count; k++) {
+            uint8x16_t in = vandq_u8(vcgeq_u8(px8, vreinterpretq_u8_u32(vdupq_n_u32(low[k]))),
+                                     vcleq_u8(px8, vreinterpretq_u8_u32(vdupq_n_u32(high[k]))));
+            uint32x4_t match = vceqq_u32(vreinterpretq_u32_u8(in), ones);
+            px = vbslq_u32(match, vorrq_u32(rgb, vdupq_n_u32(alpha[k])), px);
+        }
+
+        vst1q_u32(pixels + i, px);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    for(; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(pixels + i));
+        __m128i rgb = _mm_and_si128(px, rgb_mask);
+
+        for(int k = 0; k < key_count; k++) {
+            /* unsigned range test of the bytes: max(x, low) == x && min(x, high) == x */
+            __m128i in = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(px, _mm_set1_epi32((int)low[k])), px),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(px, _mm_set1_epi32((int)high[k])), px));
+            __m128i match = _mm_cmpeq_epi32(in, ones);
+            __m128i keyed = _mm_or_si128(rgb, _mm_set1_epi32((int)alpha[k]));
+            px = _mm_or_si128(_mm_and_si128(match, keyed), _mm_andnot_si128(match, px));
+        }
+
+        _mm_storeu_si128((__m128i *)(pixels + i), px);
+    }
+#endif
+
+    for(; i < count; i++) {
+        vg_lite_uint32_t px = pixels[i];
+
+        for(int k = 0; k < key_count; k++) {
+            if(R(px) >= R(low[k]) && R(px) <= R(high[k]) && G(px) >= G(low[k]) && G(px) <= G(high[k])
+               && B(px) >= B(low[k]) && B(px) <= B(high[k])) {
+                px = (px & 0x00FFFFFF) | alpha[k];
+            }
+        }
+
+        pixels[i] = px;
+    }
+}
+
+static void color_stage_update(vg_lite_ctx * ctx)
+{
+    /**
+     * The gamma, the pixel matrix and the color transform run in that order on the straight alpha
+     * colors of the decoded images. The per channel stages are tables; a matrix that only scales
+     * and biases each channel is folded into them, one that mixes the channels runs in between.
+     */
+    vg_lite_color_stage_t * stage = &ctx->color_stage;
+    stage->serial++;
+
+    /* the lanes in the vg_color32_t byte order, the matrix rows and columns in the A R G B order */
+    static const int lane_row[4] = { 3, 2, 1, 0 };
+    const vg_lite_uint8_t channel_enable[4] = {
+        ctx->pixel_matrix_channels.enable_b, ctx->pixel_matrix_channels.enable_g,
+        ctx->pixel_matrix_channels.enable_r, ctx->pixel_matrix_channels.enable_a
+    };
+
+    bool matrix_set = false;
+    bool mixes = false;
+
+    for(int lane = 0; lane < 4; lane++) {
+        const vg_lite_float_t * row = &ctx->pixel_matrix[lane_row[lane] * 5];
+
+        for(int col = 0; col < 4; col++) {
+            /* a disabled channel keeps its value */
+            vg_lite_float_t m = channel_enable[lane] ? row[lane_row[col]] : (col == lane ? 1.0f : 0.0f);
+            stage->matrix[lane][col] = m;
+            matrix_set = matrix_set || m != (col == lane ? 1.0f : 0.0f);
+            mixes = mixes || (col != lane && m != 0.0f);
+        }
+
+        /* the bias is in 0 ~ 1 like the colors, the tables work on 0 ~ 255 */
+        stage->matrix[lane][4] = channel_enable[lane] ? row[4] * 255.0f : 0.0f;
+        matrix_set = matrix_set || stage->matrix[lane][4] != 0.0f;
+    }
+
+    const vg_lite_color_transform_t * transform = &ctx->color_transform;
+    const vg_lite_float_t scale[4] = { transform->b_scale, transform->g_scale, transform->r_scale, transform->a_scale };
+    const vg_lite_float_t bias[4] = { transform->b_bias, transform->g_bias, transform->r_bias, transform->a_bias };
+    bool transform_set = ctx->color_transform_enabled;
+
+    stage->enabled = ctx->gamma_conversion != VG_LITE_GAMMA_NO_CONVERSION || matrix_set || transform_set;
+    stage->mixes = mixes;
+
+    if(!stage->enabled) {
+        return;
+    }
+
+    for(int lane = 0; lane < 4; lane++) {
+        for(int v = 0; v < 256; v++) {
+            vg_lite_float_t c = v / 255.0f;
+
+            /* the alpha is never gamma converted */
+            if(lane != 3 && ctx->gamma_conversion == VG_LITE_GAMMA_LINEAR) {
+                c = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+            else if(lane != 3 && ctx->gamma_conversion == VG_LITE_GAMMA_NON_LINEAR) {
+                c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+            }
+
+            if(!mixes) {
+                c = c * stage->matrix[lane][lane] + stage->matrix[lane][4] / 255.0f;
+            }
+            else {
+                stage->pre[lane][v] = (uint8_t)CLAMP((int32_t)(c * 255.0f + 0.5f), 0, 255);
+                c = v / 255.0f;
+            }
+
+            if(transform_set) {
+                c = c * scale[lane] + bias[lane];
+            }
+
+            /* with a mixing matrix this is the table after it, the one before is 'pre' */
+            stage->post[lane][v] = (uint8_t)CLAMP((int32_t)(c * 255.0f + 0.5f), 0, 255);
+        }
+    }
+}
+
+static inline vg_lite_uint32_t color_stage_lookup(const uint8_t lut[4][256], vg_lite_uint32_t px)
+{
+    return (vg_lite_uint32_t)lut[3][A(px)] << 24 | (vg_lite_uint32_t)lut[2][R(px)] << 16
+           | (vg_lite_uint32_t)lut[1][G(px)] << 8 | lut[0][B(px)];
+}
+
+static void color_stage_apply(const vg_lite_color_stage_t * stage, vg_lite_uint32_t * pixels, vg_lite_uint32_t count)
+{
+    if(!stage->mixes) {
+        for(vg_lite_uint32_t i = 0; i < count; i++) {
+            pixels[i] = color_stage_lookup(stage->post, pixels[i]);
+        }
+        return;
+    }
+
+    /* one pixel per vector, the columns of the matrix are weighted by its channels */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t cols[4];
+    float lanes[4];
+
+    for(int col = 0; col < 5; col++) {
+        for(int lane = 0; lane < 4; lane++) {
+            /* truncated by the conversion, the rounding goes with the bias */
+            lanes[lane] = col == 4 ? stage->matrix[lane][col] + 0.5f : stage->matrix[lane][col];
+        }
+        if(col < 4) {
+            cols[col] = vld1q_f32(lanes);
+        }
+    }
+    const float32x4_t bias = vld1q_f32(lanes);
+
+    for(vg_lite_uint32_t i = 0; i < count; i++) {
+        vg_lite_uint32_t px = color_stage_lookup(stage->pre, pixels[i]);
+        uint16x4_t c16 = vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(px))));
+        float32x4_t c = vcvtq_f32_u32(vmovl_u16(c16));
+        float32x4_t out = bias;
+        out = vmlaq_lane_f32(out, cols[0], vget_low_f32(c), 0);
+        out = vmlaq_lane_f32(out, cols[1], vget_low_f32(c), 1);
+        out = vmlaq_lane_f32(out, cols[2], vget_high_f32(c), 0);
+        out = vmlaq_lane_f32(out, cols[3], vget_high_f32(c), 1);
+
+        /* the conversion saturates the negative values to 0 */
+        uint16x4_t o16 = vqmovn_u32(vcvtq_u32_f32(out));
+        uint8x8_t o8 = vqmovn_u16(vcombine_u16(o16, o16));
+        px = vget_lane_u32(vreinterpret_u32_u8(o8), 0);
+        pixels[i] = color_stage_lookup(stage->post, px);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 cols[4];
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 bias = _mm_setr_ps(stage->matrix[0][4], stage->matrix[1][4], stage->matrix[2][4], stage->matrix[3][4]);
+
+    for(int col = 0; col < 4; col++) {
+        cols[col] = _mm_setr_ps(stage->matrix[0][col], stage->matrix[1][col], stage->matrix[2][col], stage->matrix[3][col]);
+    }
+
+    for(vg_lite_uint32_t i = 0; i < count; i++) {
+        vg_lite_uint32_t px = color_stage_lookup(stage->pre, pixels[i]);
+        __m128i c32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)px), zero), zero);
+        __m128 c = _mm_cvtepi32_ps(c32);
+        __m128 out = _mm_add_ps(bias, _mm_mul_ps(cols[0], _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0))));
+        out = _mm_add_ps(out, _mm_mul_ps(cols[1], _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1))));
+        out = _mm_add_ps(out, _mm_mul_ps(cols[2], _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2))));
+        out = _mm_add_ps(out, _mm_mul_ps(cols[3], _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        /* rounded by the conversion, the packs saturate to 0 ~ 255 */
+        __m128i o32 = _mm_cvtps_epi32(out);
+        __m128i o16 = _mm_packs_epi32(o32, o32);
+        px = (vg_lite_uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(o16, o16));
+        pixels[i] = color_stage_lookup(stage->post, px);
+    }
+#else
+    for(vg_lite_uint32_t i = 0; i < count; i++) {
+        vg_lite_uint32_t px = color_stage_lookup(stage->pre, pixels[i]);
+        vg_lite_uint32_t out = 0;
+
+        for(int lane = 0; lane < 4; lane++) {
+            vg_lite_float_t v = stage->matrix[lane][4] + 0.5f;
+            for(int col = 0; col < 4; col++) {
+                v += stage->matrix[lane][col] * ((px >> (col * 8)) & 0xFF);
+            }
+            out |= (vg_lite_uint32_t)CLAMP((int32_t)v, 0, 255) << (lane * 8);
+        }
+
+        pixels[i] = color_stage_lookup(stage->post, out);
+    }
+#endif
+}
+
+static vg_lite_color_t color_transform_apply(const vg_lite_ctx * ctx, vg_lite_color_t color)
+{
+    /* the paint colors only go through the color transform, in the A B G R order of vg_lite_color_t */
+    if(!ctx->color_transform_enabled) {
+        return color;
+    }
+
+    const vg_lite_color_transform_t * transform = &ctx->color_transform;
+    const vg_lite_float_t scale[4] = { transform->r_scale, transform->g_scale, transform->b_scale, transform->a_scale };
+    const vg_lite_float_t bias[4] = { transform->r_bias, transform->g_bias, transform->b_bias, transform->a_bias };
+    vg_lite_color_t out = 0;
+
+    for(int lane = 0; lane < 4; lane++) {
+        vg_lite_float_t c = ((color >> (lane * 8)) & 0xFF) / 255.0f * scale[lane] + bias[lane];
+        out |= (vg_lite_color_t)CLAMP((int32_t)(c * 255.0f + 0.5f), 0, 255) << (lane * 8);
+    }
+
+    return out;
+}
+
+static const vg_lite_uint32_t * picture_decode(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                               vg_lite_color_t color, bool global_alpha)
+{
+    vg_lite_uint32_t * image_buffer;
+
+    /* a global alpha is replaced by the last pass over the pixels, never in the application's memory */
+    bool alpha_pending = global_alpha && ctx->raster.src_alpha_mode == VG_LITE_GLOBAL;
+    vg_lite_uint8_t alpha_value = ctx->raster.src_alpha_value;
+
+    /* At least 8-byte alignment */
+    LV_ASSERT(VG_LITE_IS_ALIGNED(source->memory, 8));
+    mapping_begin(ctx, source);
+
+    /**
+     * Since ThorVG's picture->load does not support stride,
+     * reconversion is required when the stride and width do not match.
+     */
+    if(source->format == VG_LITE_BGRA8888
+       && source->image_mode == VG_LITE_NORMAL_IMAGE_MODE
+       && (size_t)source->stride == (size_t)(source->width * sizeof(vg_lite_uint32_t))
+       && !ctx->color_key_enabled
+       && !ctx->color_stage.enabled
+       && !alpha_pending) {
+        image_buffer = (vg_lite_uint32_t *)source->memory;
+    }
+    else {
+        vg_lite_uint32_t width = source->width;
+        vg_lite_uint32_t height = source->height;
+        image_buffer = ctx->get_image_buffer(width, height);
+
+        vg_lite_buffer_t target;
+        memset(&target, 0, sizeof(target));
+        target.memory = image_buffer;
+        target.format = VG_LITE_BGRA8888;
+        target.width = width;
+        target.height = height;
+        target.stride = width * sizeof(vg_lite_uint32_t);
+
+        bool indexed = source->format == VG_LITE_INDEX_1 || source->format == VG_LITE_INDEX_2
+                       || source->format == VG_LITE_INDEX_4 || source->format == VG_LITE_INDEX_8;
+        bool multiply = source->image_mode == VG_LITE_MULTIPLY_IMAGE_MODE && !VG_LITE_IS_ALPHA_FORMAT(source->format);
+
+        /* with nothing to run on the pixels after them, the converters replace the alpha themselves */
+        int32_t row_alpha = -1;
+        if(alpha_pending && !indexed && !multiply && !ctx->color_key_enabled && !ctx->color_stage.enabled
+           && source->format != VG_LITE_NV12) {
+            row_alpha = alpha_value;
+            alpha_pending = false;
+        }
+
+        switch(source->format) {
+            case VG_LITE_INDEX_1:
+            case VG_LITE_INDEX_2:
+            case VG_LITE_INDEX_4:
+            case VG_LITE_INDEX_8: {
+                    const vg_lite_uint32_t * clut_colors = ctx->get_CLUT(source->format);
+                    vg_lite_uint32_t keyed_clut[256];
+
+                    bool clut_alpha = alpha_pending && !multiply;
+
+                    if(ctx->color_key_enabled || ctx->color_stage.enabled || clut_alpha) {
+                        /* the palette is keyed and transformed instead of the pixels */
+                        vg_lite_uint32_t clut_count = source->format == VG_LITE_INDEX_8 ? 256
+                                                      : source->format == VG_LITE_INDEX_4 ? 16
+                                                      : source->format == VG_LITE_INDEX_2 ? 4 : 2;
+                        memcpy(keyed_clut, clut_colors, clut_count * sizeof(vg_lite_uint32_t));
+                        if(ctx->color_key_enabled) {
+                            color_key_apply(ctx->color_keys, keyed_clut, clut_count);
+                        }
+                        if(ctx->color_stage.enabled) {
+                            color_stage_apply(&ctx->color_stage, keyed_clut, clut_count);
+                        }
+                        if(clut_alpha) {
+                            for(vg_lite_uint32_t i = 0; i < clut_count; i++) {
+                                keyed_clut[i] = pixel_global_alpha(keyed_clut[i], VG_LITE_GLOBAL, alpha_value);
+                            }
+                            alpha_pending = false;
+                        }
+                        clut_colors = keyed_clut;
+                    }
+
+                    for(vg_lite_uint32_t y = 0; y < height; y++) {
+                        decode_indexed_line(source->format, clut_colors, 0, y, width, source->stride, (uint8_t *)source->memory, image_buffer);
+                    }
+                }
+                break;
+
+            case VG_LITE_A4: {
+                    conv_alpha4_to_bgra8888.convert(&target, source, color, row_alpha);
+                }
+                break;
+
+            case VG_LITE_A8: {
+                    conv_alpha8_to_bgra8888.convert(&target, source, color, row_alpha);
+                }
+                break;
+
+            case VG_LITE_L8: {
+                    conv_l8_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGRX8888: {
+                    conv_bgrx8888_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGR888: {
+                    conv_bgr888_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGRA5658: {
+                    conv_bgra5658_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGR565: {
+                    conv_bgr565_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGRA5551: {
+                    conv_bgra5551_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGRA4444: {
+                    conv_bgra4444_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_BGRA2222: {
+                    conv_bgra2222_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+#if LV_VG_LITE_THORVG_YUV_SUPPORT
+            case VG_LITE_NV12: {
+                    libyuv::NV12ToARGB((const uint8_t *)source->memory, source->stride, (const uint8_t *)source->yuv.uv_memory,
+                                       source->yuv.uv_stride,
+                                       (uint8_t *)image_buffer, source->width * sizeof(vg_lite_uint32_t), width, height);
+                }
+                break;
+#endif
+
+            case VG_LITE_BGRA8888: {
+                    /* For stride conversion */
+                    conv_bgra8888_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            case VG_LITE_RGBA8888: {
+                    conv_rgba8888_to_bgra8888.convert(&target, source, 0, row_alpha);
+                }
+                break;
+
+            default:
+                LV_LOG_ERROR("unsupported format: %d", source->format);
+                LV_ASSERT(false);
+                break;
+        }
+
+        /* applied on the rows just converted, before the color multiplies the RGB the keys compare */
+        if(ctx->color_key_enabled && !indexed) {
+            color_key_apply(ctx->color_keys, image_buffer, width * height);
+        }
+
+        if(ctx->color_stage.enabled && !indexed) {
+            color_stage_apply(&ctx->color_stage, image_buffer, width * height);
+        }
+
+        /* multiply color */
+        if(multiply) {
+            vg_color32_t * dest = (vg_color32_t *)image_buffer;
+            vg_lite_uint32_t px_size = width * height;
+            while(px_size--) {
+                dest->alpha = alpha_pending ? alpha_value : UDIV255(dest->alpha * A(color));
+                dest->red = UDIV255(dest->red * B(color));
+                dest->green = UDIV255(dest->green * G(color));
+                dest->blue = UDIV255(dest->blue * R(color));
+                dest++;
+            }
+            alpha_pending = false;
+        }
+
+        /* the keyed or transformed pixels of the direct formats, and the YUV ones */
+        if(alpha_pending) {
+            vg_lite_uint32_t px_size = width * height;
+            for(vg_lite_uint32_t i = 0; i < px_size; i++) {
+                image_buffer[i] = pixel_global_alpha(image_buffer[i], VG_LITE_GLOBAL, alpha_value);
+            }
+        }
+    }
+
+    return image_buffer;
+}
+
+static Result picture_load(vg_lite_ctx * ctx, std::unique_ptr<Picture> & picture, const vg_lite_buffer_t * source,
+                           vg_lite_color_t color)
+{
+    /* a global alpha is replaced by the decode itself, a scaled one is the picture's opacity */
+    const vg_lite_uint32_t * image_buffer = picture_decode(ctx, source, color, true);
+    vg_lite_global_alpha_t mode = ctx->raster.src_alpha_mode;
+
+#if LV_VG_LITE_THORVG_USE_RELEASE
+    TVG_CHECK_RETURN_RESULT(picture->load((uint32_t *)image_buffer, source->width, source->height, true));
+#else
+    TVG_CHECK_RETURN_RESULT(picture->load((uint32_t *)image_buffer, source->width, source->height, false, true));
+#endif
+
+    if(mode == VG_LITE_SCALED) {
+        TVG_CHECK_RETURN_RESULT(picture->opacity(ctx->raster.src_alpha_value));
+    }
+
+    return Result::Success;
+}
+
+static bool image_convert_row(vg_lite_ctx * ctx, const vg_lite_buffer_t * source, int32_t x, int32_t y,
+                              int32_t width, vg_lite_uint32_t * out)
+{
+    /* one row of the source to straight alpha ARGB8888, through the converters of the decode */
+    vg_lite_uint32_t mul, div, align;
+    get_format_bytes(source->format, &mul, &div, &align);
+
+    const uint8_t * row = (const uint8_t *)source->memory + y * source->stride;
+
+    vg_lite_buffer_t src_view = *source;
+    src_view.memory = (void *)(row + x * mul / div);
+    src_view.width = width;
+    src_view.height = 1;
+
+    vg_lite_buffer_t dest_view;
+    memset(&dest_view, 0, sizeof(dest_view));
+    dest_view.memory = out;
+    dest_view.format = VG_LITE_BGRA8888;
+    dest_view.width = width;
+    dest_view.height = 1;
+    dest_view.stride = width * sizeof(vg_lite_uint32_t);
+
+    switch(source->format) {
+        case VG_LITE_INDEX_1:
+        case VG_LITE_INDEX_2:
+        case VG_LITE_INDEX_4:
+        case VG_LITE_INDEX_8:
+            return decode_indexed_line(source->format, ctx->get_CLUT(source->format), x, 0, width, 0, row, out);
+
+        case VG_LITE_A4:
+            /* two pixels per byte, the rectangle must start and end on a whole byte */
+            if((x | width) & 1) {
+                return false;
+            }
+            conv_alpha4_to_bgra8888.convert(&dest_view, &src_view, 0);
+            return true;
+
+        case VG_LITE_A8:
+            conv_alpha8_to_bgra8888.convert(&dest_view, &src_view, 0);
+            return true;
+
+        case VG_LITE_L8:
+            conv_l8_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRX8888:
+            conv_bgrx8888_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGR888:
+            conv_bgr888_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRA5658:
+            conv_bgra5658_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGR565:
+            conv_bgr565_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRA5551:
+            conv_bgra5551_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRA4444:
+            conv_bgra4444_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRA2222:
+            conv_bgra2222_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_BGRA8888:
+            conv_bgra8888_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        case VG_LITE_RGBA8888:
+            conv_rgba8888_to_bgra8888.convert(&dest_view, &src_view);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool image_write_row(const vg_lite_buffer_t * target, int32_t x, int32_t y, int32_t width,
+                            const vg_lite_uint32_t * row)
+{
+    /* one ARGB8888 row to the format of the target, with the converters of vg_lite_finish() */
+    vg_lite_uint32_t mul, div, align;
+    get_format_bytes(target->format, &mul, &div, &align);
+
+    uint8_t * dest = (uint8_t *)target->memory + y * target->stride + x * mul / div;
+    const vg_color32_t * src = (const vg_color32_t *)row;
+
+    switch(target->format) {
+        case VG_LITE_BGR565:
+            picture_bgra8888_to_bgr565((vg_color16_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_BGRA5658:
+            picture_bgra8888_to_bgra5658((vg_color16_alpha_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_BGR888:
+            picture_bgra8888_to_bgr888((vg_color24_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_L8:
+            picture_bgra8888_to_l8(dest, src, width);
+            return true;
+
+        case VG_LITE_A8:
+            picture_bgra8888_to_alpha8(dest, src, width);
+            return true;
+
+        case VG_LITE_BGRA5551:
+            picture_bgra8888_to_bgra5551((vg_color_bgra5551_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_BGRA4444:
+            picture_bgra8888_to_bgra4444((vg_color_bgra4444_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_BGRA2222:
+            picture_bgra8888_to_bgra2222((vg_color_bgra2222_t *)dest, src, width);
+            return true;
+
+        case VG_LITE_BGRA8888:
+        case VG_LITE_BGRX8888:
+            memcpy(dest, row, width * sizeof(vg_lite_uint32_t));
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static Result image_copy(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                         int32_t sx, int32_t sy, int32_t dx, int32_t dy, int32_t width, int32_t height)
+{
+    /**
+     * The same formats are moved row by row, in the order that keeps an overlapping source intact.
+     * The others go through an ARGB8888 row, converted straight into an ARGB8888 target.
+     * The rectangle must be inside both buffers.
+     */
+    if(source->format == target->format) {
+        vg_lite_uint32_t mul, div, align;
+        get_format_bytes(source->format, &mul, &div, &align);
+
+        /* the formats below a byte per pixel are moved by whole bytes */
+        if((sx * mul) % div || (dx * mul) % div || (width * mul) % div) {
+            return Result::NonSupport;
+        }
+
+        size_t row_bytes = width * mul / div;
+        const uint8_t * src = (const uint8_t *)source->memory + sy * source->stride + sx * mul / div;
+        uint8_t * dest = (uint8_t *)target->memory + dy * target->stride + dx * mul / div;
+
+        if(source->stride == target->stride && row_bytes == (size_t)source->stride) {
+            /* whole rows are one block */
+            memmove(dest, src, row_bytes * height);
+            return Result::Success;
+        }
+
+        if(dest > src) {
+            /* a target below its source in the same buffer is copied from the last row up */
+            for(int32_t y = height - 1; y >= 0; y--) {
+                memmove(dest + y * target->stride, src + y * source->stride, row_bytes);
+            }
+        }
+        else {
+            for(int32_t y = 0; y < height; y++) {
+                memmove(dest + y * target->stride, src + y * source->stride, row_bytes);
+            }
+        }
+
+        return Result::Success;
+    }
+
+    bool direct = target->format == VG_LITE_BGRA8888 || target->format == VG_LITE_BGRX8888;
+    vg_lite_uint32_t * row = direct ? nullptr : ctx->get_image_buffer(width, 1);
+
+    for(int32_t y = 0; y < height; y++) {
+        vg_lite_uint32_t * out = direct
+                                 ? (vg_lite_uint32_t *)((uint8_t *)target->memory + (dy + y) * target->stride) + dx
+                                 : row;
+
+        if(!image_convert_row(ctx, source, sx, sy + y, width, out)) {
+            return Result::NonSupport;
+        }
+
+        if(!direct && !image_write_row(target, dx, dy + y, width, row)) {
+            return Result::NonSupport;
+        }
+    }
+
+    return Result::Success;
+}
+
+static Result raster_blit(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                          const vg_lite_rectangle_t * rect, const vg_lite_matrix_t * matrix, vg_lite_blend_t blend,
+                          vg_lite_color_t color, vg_lite_filter_t filter)
+{
+    /* a whole pixel translation maps the source rows onto the target rows, nothing to resample */
+    if(ctx->raster.mask) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_blit_t blit;
+    vg_lite_ibox_t area;
+    bool flipped;
+    if(!blit_prepare(&blit, source, rect, matrix) || !blit_get_offset(&blit, filter, &area, &flipped)) {
+        return Result::NonSupport;
+    }
+
+    /* the rasterizer clips to a single rectangle */
+    vg_lite_ibox_t clip;
+    if(!scissor_get_clip(ctx, target, &clip)) {
+        return Result::NonSupport;
+    }
+
+    clip.x_min = MAX(clip.x_min, area.x_min);
+    clip.y_min = MAX(clip.y_min, area.y_min);
+    clip.x_max = MIN(clip.x_max, area.x_max);
+    clip.y_max = MIN(clip.y_max, area.y_max);
+
+    if(clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return Result::Success;
+    }
+
+    /* the paints pushed before must land first where they overlap */
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, nullptr, source));
+
+    const vg_lite_uint32_t * image = picture_decode(ctx, source, color, false);
+    int32_t image_stride = source->width;
+    vg_lite_uint32_t * dest = (vg_lite_uint32_t *)ctx->tvg_target_buffer;
+
+    for(int32_t y = clip.y_min; y < clip.y_max; y++) {
+        int32_t src_y = flipped ? area.y_max - 1 - y : y - area.y_min;
+        const vg_lite_uint32_t * src_row = image + (src_y + blit.src_box.y_min) * image_stride
+                                           + blit.src_box.x_min + clip.x_min - area.x_min;
+        vg_lite_uint32_t * dest_row = dest + y * ctx->tvg_target_stride + clip.x_min;
+
+        blit_blend_row(&ctx->raster, dest_row, src_row, 0, clip.x_max - clip.x_min, blend);
+    }
+
+    ctx->target_dirty = true;
+    return Result::Success;
+}
+
+static const vg_lite_uint32_t * sampler_prepare_image(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                                      vg_lite_color_t color, const vg_lite_ibox_t * box, int slot)
+{
+    /* filtering mixes neighbouring texels, that needs premultiplied colors */
+    const vg_lite_uint32_t * decoded = picture_decode(ctx, source, color, false);
+    int32_t stride = (int32_t)source->width;
+    vg_lite_uint32_t * image = ctx->get_sample_buffer(source->width, source->height, slot);
+
+    /* the global alpha of the source is folded into the premultiplication */
+    vg_lite_global_alpha_t mode = ctx->raster.src_alpha_mode;
+    vg_lite_uint8_t value = ctx->raster.src_alpha_value;
+
+    for(int32_t y = box->y_min; y < box->y_max; y++) {
+        const vg_lite_uint32_t * src_row = decoded + y * stride;
+        vg_lite_uint32_t * dest_row = image + y * stride;
+
+        for(int32_t x = box->x_min; x < box->x_max; x++) {
+            vg_lite_uint32_t px = mode == VG_LITE_NORMAL ? src_row[x] : pixel_global_alpha(src_row[x], mode, value);
+            vg_lite_uint32_t alpha = A(px);
+            dest_row[x] = alpha == 0xFF ? px : (pixel_scale(px, alpha) & 0x00ffffff) | (alpha << 24);
+        }
+    }
+
+    return image;
+}
+
+static void sampler_init(vg_lite_ctx * ctx, vg_lite_sampler_t * sampler, const vg_lite_uint32_t * image,
+                         int32_t stride, const vg_lite_ibox_t * box, vg_lite_filter_t filter)
+{
+    /* the inverse matrix is left to the caller */
+    sampler->image = image;
+    sampler->stride = stride;
+    sampler->box = *box;
+    sampler->filter = filter;
+    sampler->mode = VG_LITE_PATTERN_PAD;
+    sampler->border = 0;
+    memcpy(sampler->gaussian, ctx->gaussian_weights, sizeof(sampler->gaussian));
+}
+
+static vg_lite_uint32_t mip_get_level(const vg_lite_buffer_t * source, const vg_lite_matrix_t * matrix,
+                                      vg_lite_filter_t filter)
+{
+    /* nearest sampling is asked for on purpose, a projection has no single scale */
+    if(LV_VG_LITE_THORVG_MIP_CACHE_SIZE == 0 || filter == VG_LITE_FILTER_POINT || matrix_has_perspective(matrix)) {
+        return 0;
+    }
+
+    /* the largest stretch picks the level, so the image is never blurrier than the bilinear filter alone */
+    vg_lite_float_t scale = matrix_get_scale(matrix);
+    vg_lite_uint32_t level = 0;
+
+    while(scale * 2 <= 1.0f && (source->width >> (level + 1)) && (source->height >> (level + 1))) {
+        scale *= 2;
+        level++;
+    }
+
+    return level;
+}
+
+static vg_lite_uint32_t mip_signature(const vg_lite_buffer_t * source)
+{
+    /**
+     * FNV-1a of every word of the source: the memory of a freed image is often reused for
+     * another one of the same size, which may only differ away from a sparse sample.
+     * Four interleaved lanes keep the multiplies independent, a pass costs a plain read.
+     */
+    const uint8_t * memory = (const uint8_t *)source->memory;
+    vg_lite_uint32_t lanes[4] = { 0x811C9DC5, 0x811C9DC5, 0x811C9DC5, 0x811C9DC5 };
+
+    vg_lite_uint32_t mul, div, align;
+    get_format_bytes(source->format, &mul, &div, &align);
+    size_t row_bytes = MIN((size_t)source->stride, (size_t)source->width * mul / div);
+
+    if(!memory) {
+        return lanes[0];
+    }
+
+    for(vg_lite_uint32_t y = 0; y < source->height; y++) {
+        const uint8_t * row = memory + (size_t)y * source->stride;
+        size_t i = 0;
+
+        for(; i + 16 <= row_bytes; i += 16) {
+            vg_lite_uint32_t words[4];
+            memcpy(words, row + i, sizeof(words));
+            for(int k = 0; k < 4; k++) {
+                lanes[k] = (lanes[k] ^ words[k]) * 0x01000193;
+            }
+        }
+
+        for(; i < row_bytes; i++) {
+            lanes[0] = (lanes[0] ^ row[i]) * 0x01000193;
+        }
+    }
+
+    return ((lanes[0] * 0x01000193 ^ lanes[1]) * 0x01000193 ^ lanes[2]) * 0x01000193 ^ lanes[3];
+}
+
+static inline vg_lite_uint32_t pixel_average4(vg_lite_uint32_t a, vg_lite_uint32_t b, vg_lite_uint32_t c,
+                                              vg_lite_uint32_t d)
+{
+    /* the lanes hold the sums of four bytes in 10 bits */
+    vg_lite_uint32_t rb = (a & 0x00ff00ff) + (b & 0x00ff00ff) + (c & 0x00ff00ff) + (d & 0x00ff00ff) + 0x00020002;
+    vg_lite_uint32_t ag = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff) + ((c >> 8) & 0x00ff00ff)
+                          + ((d >> 8) & 0x00ff00ff) + 0x00020002;
+    return ((rb >> 2) & 0x00ff00ff) | ((ag << 6) & 0xff00ff00);
+}
+
+static void mip_downsample(vg_lite_mip_level_t * dest, const vg_lite_uint32_t * src, vg_lite_uint32_t src_width,
+                           vg_lite_uint32_t src_height)
+{
+    /* 2x2 box filter, an odd last row or column is averaged with itself so the scale stays exactly 2 */
+    dest->width = (src_width + 1) / 2;
+    dest->height = (src_height + 1) / 2;
+    dest->pixels.resize(dest->width * dest->height);
+
+    for(vg_lite_uint32_t y = 0; y < dest->height; y++) {
+        const vg_lite_uint32_t * row0 = src + (y * 2) * src_width;
+        const vg_lite_uint32_t * row1 = src + (MIN(y * 2 + 1, src_height - 1)) * src_width;
+        vg_lite_uint32_t * out = dest->pixels.data() + y * dest->width;
+        vg_lite_uint32_t x = 0;
+
+        /* both pixels of a pair exist up to here */
+        vg_lite_uint32_t pairs = src_width / 2;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        for(; x + 4 <= pairs; x += 4) {
+            uint32x4x2_t p0 = vld2q_u32(row0 + x * 2);
+            uint32x4x2_t p1 = vld2q_u32(row1 + x * 2);
+            uint8x16_t top = vrhaddq_u8(vreinterpretq_u8_u32(p0.val[0]), vreinterpretq_u8_u32(p0.val[1]));
+            uint8x16_t bottom = vrhaddq_u8(vreinterpretq_u8_u32(p1.val[0]), vreinterpretq_u8_u32(p1.val[1]));
+            vst1q_u32(out + x, vreinterpretq_u32_u8(vrhaddq_u8(top, bottom)));
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        for(; x + 4 <= pairs; x += 4) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + x * 2));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + x * 2 + 4));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + x * 2));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + x * 2 + 4));
+            __m128 v0 = _mm_castsi128_ps(_mm_avg_epu8(a0, b0));
+            __m128 v1 = _mm_castsi128_ps(_mm_avg_epu8(a1, b1));
+            __m128i even = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i odd = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_si128((__m128i *)(out + x), _mm_avg_epu8(even, odd));
+        }
+#endif
+
+        for(; x < dest->width; x++) {
+            vg_lite_uint32_t x0 = x * 2;
+            vg_lite_uint32_t x1 = MIN(x0 + 1, src_width - 1);
+            out[x] = pixel_average4(row0[x0], row0[x1], row1[x0], row1[x1]);
+        }
+    }
+}
+
+static const vg_lite_mip_level_t * mip_cache_get(vg_lite_ctx * ctx, const vg_lite_buffer_t * source,
+                                                 vg_lite_color_t color, vg_lite_uint32_t level, int slot)
+{
+    /**
+     * The levels are made on demand from the smallest one already there, a hit reads
+     * the source once for its signature, never decodes it.
+     * The paints pushed before must have been flushed, the source may be decoded again.
+     * The level stays valid until mip_cache_trim() is called.
+     */
+    LV_ASSERT(level > 0);
+
+    vg_lite_mip_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.memory = source->memory;
+    key.width = source->width;
+    key.height = source->height;
+    key.stride = source->stride;
+    key.format = source->format;
+    key.image_mode = source->image_mode;
+    key.color = color;
+    key.src_alpha = ctx->raster.src_alpha_mode == VG_LITE_NORMAL ? 0
+                    : (vg_lite_uint32_t)ctx->raster.src_alpha_mode << 8 | ctx->raster.src_alpha_value;
+    memcpy(key.color_keys, ctx->color_keys, sizeof(key.color_keys));
+    key.color_stage = ctx->color_stage.enabled ? ctx->color_stage.serial : 0;
+    key.signature = mip_signature(source);
+
+    auto & cache = ctx->mip_cache;
+    auto it = std::find_if(cache.begin(), cache.end(), [&key](const vg_lite_mip_t & mip) {
+        return memcmp(&mip.key, &key, sizeof(key)) == 0;
+    });
+
+    if(it != cache.end()) {
+        cache.splice(cache.begin(), cache, it);
+    }
+    else {
+        cache.emplace_front();
+        cache.front().key = key;
+        cache.front().size = 0;
+    }
+
+    vg_lite_mip_t * mip = &cache.front();
+
+    while(mip->levels.size() < level) {
+        const vg_lite_uint32_t * base;
+        vg_lite_uint32_t base_width;
+        vg_lite_uint32_t base_height;
+
+        if(mip->levels.empty()) {
+            vg_lite_ibox_t box = { 0, 0, (int32_t)source->width, (int32_t)source->height };
+            base = sampler_prepare_image(ctx, source, color, &box, slot);
+            base_width = source->width;
+            base_height = source->height;
+        }
+        else {
+            base = mip->levels.back().pixels.data();
+            base_width = mip->levels.back().width;
+            base_height = mip->levels.back().height;
+        }
+
+        /* the vector may move the levels, the base is read before it grows */
+        vg_lite_mip_level_t next;
+        mip_downsample(&next, base, base_width, base_height);
+        mip->size += next.pixels.size() * sizeof(vg_lite_uint32_t);
+        ctx->mip_cache_size += next.pixels.size() * sizeof(vg_lite_uint32_t);
+        mip->levels.push_back(std::move(next));
+    }
+
+    return &mip->levels[level - 1];
+}
+
+static void mip_cache_trim(vg_lite_ctx * ctx)
+{
+    /* the source used last is kept even when it alone goes over the budget */
+    auto & cache = ctx->mip_cache;
+    while(ctx->mip_cache_size > LV_VG_LITE_THORVG_MIP_CACHE_SIZE && cache.size() > 1) {
+        ctx->mip_cache_size -= cache.back().size;
+        cache.pop_back();
+    }
+}
+
+static void mip_cache_drop(vg_lite_ctx * ctx, const vg_lite_buffer_t * source)
+{
+    ctx->mip_cache.remove_if([ctx, source](const vg_lite_mip_t & mip) {
+        if(mip.key.memory != source->memory) {
+            return false;
+        }
+
+        ctx->mip_cache_size -= mip.size;
+        return true;
+    });
+}
+
+static size_t pool_class_size(size_t size)
+{
+    /* 4 classes per power of two above 256 bytes, a block is at most 25% larger than asked */
+    size_t base = 256;
+    if(size <= base) {
+        return base;
+    }
+
+    while(base * 2 < size) {
+        base *= 2;
+    }
+
+    return VG_LITE_ALIGN(size, MAX(base / 4, (size_t)LV_VG_LITE_THORVG_BUF_ADDR_ALIGN));
+}
+
+static vg_lite_error_t pool_alloc(vg_lite_ctx * ctx, size_t size, void ** memory)
+{
+    vg_lite_pool_t * pool = &ctx->pool;
+    size_t class_size = pool_class_size(size);
+
+    auto it = pool->free_blocks.find(class_size);
+    if(it != pool->free_blocks.end() && !it->second.empty()) {
+        *memory = it->second.back();
+        it->second.pop_back();
+        pool->cached_size -= class_size;
+    }
+    else {
+        /* the budget is a fixed carve-out: the live blocks plus the cached ones */
+        if(LV_VG_LITE_THORVG_MEM_BUDGET) {
+            if(pool->live_size + class_size > (size_t)LV_VG_LITE_THORVG_MEM_BUDGET) {
+                return VG_LITE_OUT_OF_MEMORY;
+            }
+
+            pool_trim(ctx, LV_VG_LITE_THORVG_MEM_BUDGET - pool->live_size - class_size);
+        }
+
+        /* the sizes of the classes are multiples of the alignment, as aligned_alloc() requires */
+#ifndef _WIN32
+        *memory = aligned_alloc(LV_VG_LITE_THORVG_BUF_ADDR_ALIGN, class_size);
+#else
+        *memory = _aligned_malloc(class_size, LV_VG_LITE_THORVG_BUF_ADDR_ALIGN);
+#endif
+
+        if(!*memory && pool->cached_size) {
+            /* the heap may be short because of the cached blocks */
+            pool_trim(ctx, 0);
+#ifndef _WIN32
+            *memory = aligned_alloc(LV_VG_LITE_THORVG_BUF_ADDR_ALIGN, class_size);
+#else
+            *memory = _aligned_malloc(class_size, LV_VG_LITE_THORVG_BUF_ADDR_ALIGN);
+#endif
+        }
+
+        if(!*memory) {
+            return VG_LITE_OUT_OF_MEMORY;
+        }
+    }
+
+    pool->used_blocks[*memory] = class_size;
+    pool->live_size += class_size;
+    pool->peak_size = MAX(pool->peak_size, pool->live_size);
+    return VG_LITE_SUCCESS;
+}
+
+static bool pool_free(vg_lite_ctx * ctx, void * memory)
+{
+    vg_lite_pool_t * pool = &ctx->pool;
+
+    auto it = pool->used_blocks.find(memory);
+    if(it == pool->used_blocks.end()) {
+        return false;
+    }
+
+    size_t class_size = it->second;
+    pool->used_blocks.erase(it);
+    pool->live_size -= class_size;
+
+    /* kept for the next buffer of the same class, the layers come and go every frame */
+    pool->free_blocks[class_size].push_back(memory);
+    pool->cached_size += class_size;
+    pool_trim(ctx, LV_VG_LITE_THORVG_MEM_POOL_CACHE_SIZE);
+    return true;
+}
+
+static void pool_trim(vg_lite_ctx * ctx, size_t cached_max)
+{
+    /* the largest blocks are released first, they give the most back */
+    vg_lite_pool_t * pool = &ctx->pool;
+
+    while(pool->cached_size > cached_max) {
+        auto it = std::prev(pool->free_blocks.end());
+        if(it->second.empty()) {
+            pool->free_blocks.erase(it);
+            continue;
+        }
+
+#ifndef _WIN32
+        free(it->second.back());
+#else
+        _aligned_free(it->second.back());
+#endif
+        it->second.pop_back();
+        pool->cached_size -= it->first;
+    }
+}
+
+static bool mapping_sync(const vg_lite_mapping_t * mapping, bool start)
+{
+    /* brackets the CPU access to a dma-buf, false when the fd is not one */
+#if LV_VG_LITE_THORVG_DMABUF_SUPPORT
+    struct dma_buf_sync sync;
+    sync.flags = (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END) | DMA_BUF_SYNC_RW;
+    return ioctl(mapping->fd, DMA_BUF_IOCTL_SYNC, &sync) == 0;
+#else
+    LV_UNUSED(mapping);
+    LV_UNUSED(start);
+    return false;
+#endif
+}
+
+static void mapping_begin(vg_lite_ctx * ctx, const vg_lite_buffer_t * buffer)
+{
+    /* a draw starts the CPU access to the dma-buf it reads or writes, vg_lite_finish() ends it */
+    if(ctx->mappings.empty()) {
+        return;
+    }
+
+    auto it = ctx->mappings.find(buffer->memory);
+    if(it != ctx->mappings.end() && it->second.dmabuf && !it->second.synced) {
+        it->second.synced = mapping_sync(&it->second, true);
+    }
+}
+
+static void mapping_end(vg_lite_ctx * ctx)
+{
+    for(auto & it : ctx->mappings) {
+        if(it.second.synced) {
+            mapping_sync(&it.second, false);
+            it.second.synced = false;
+        }
+    }
+}
+
+static Result raster_blit_transform(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source,
+                                    const vg_lite_rectangle_t * rect, const vg_lite_matrix_t * matrix,
+                                    vg_lite_blend_t blend, vg_lite_color_t color, vg_lite_filter_t filter)
+{
+    /**
+     * The transformed source area is filled with the sampled image: the rasterizer gives the
+     * coverage of the edges and the sampler filters the inside as requested.
+     * ThorVG drops the projective row of the matrix, perspective warps are only right here.
+     */
+    if(source->width > INT16_MAX || source->height > INT16_MAX) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_ibox_t clip;
+    if(!scissor_get_clip(ctx, target, &clip)) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_blit_t blit;
+    if(!blit_prepare(&blit, source, rect, matrix) || clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return Result::Success;
+    }
+
+    vg_lite_polygon_t * polygon = &ctx->polygon;
+    polygon->points.clear();
+    polygon->contours.clear();
+    polygon->extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+    polygon->path_extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    bool bounded = blit_add_outline(polygon, &blit, &clip);
+
+    /* the paints pushed before must land first where they overlap */
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, &polygon->extents, source));
+
+    vg_lite_sampler_t sampler;
+    blit_init_sampler(ctx, &sampler, &blit, source, color, filter, 0);
+
+    if(!bounded) {
+        /* the edges of the source are not rasterized, the outside must read as transparent */
+        sampler.mode = VG_LITE_PATTERN_COLOR;
+    }
+
+    vg_lite_raster_paint_t paint = { 0, blend, nullptr, 0, 0, 0, 0, &sampler, ctx->get_sample_span(target->width, 0) };
+
+    raster_fill_polygon(&ctx->raster, polygon, VG_LITE_FILL_NON_ZERO, quality_tier_get(VG_LITE_HIGH)->samples, &clip,
+                        &paint, (vg_lite_uint32_t *)ctx->tvg_target_buffer, ctx->tvg_target_stride);
+
+    mip_cache_trim(ctx);
+    ctx->target_dirty = true;
+    return Result::Success;
+}
+
+static Result raster_blit2(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_buffer_t * source0,
+                           const vg_lite_buffer_t * source1, const vg_lite_matrix_t * matrix0,
+                           const vg_lite_matrix_t * matrix1, vg_lite_blend_t blend, vg_lite_filter_t filter)
+{
+    /**
+     * Both sources are sampled for each covered pixel and merged before the target is
+     * read, which is then written once instead of twice.
+     * Only source over can be merged that way, the other modes are left to two blits.
+     */
+    if(!blend_is_source_over(blend)) {
+        return Result::NonSupport;
+    }
+
+    if(source0->width > INT16_MAX || source0->height > INT16_MAX
+       || source1->width > INT16_MAX || source1->height > INT16_MAX) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_ibox_t clip;
+    if(!scissor_get_clip(ctx, target, &clip)) {
+        return Result::NonSupport;
+    }
+
+    vg_lite_blit_t blits[2];
+    if(!blit_prepare(&blits[0], source0, nullptr, matrix0) || !blit_prepare(&blits[1], source1, nullptr, matrix1)) {
+        /* a single source is left, the plain blit handles it */
+        return Result::NonSupport;
+    }
+
+    if(clip.x_min >= clip.x_max || clip.y_min >= clip.y_max) {
+        return Result::Success;
+    }
+
+    vg_lite_ibox_t areas[2];
+    bool flipped[2];
+    /* the overlap of the sources is merged below as is, with neither global alpha */
+    if(!ctx->raster.mask && ctx->raster.src_alpha_mode == VG_LITE_NORMAL && ctx->raster.dest_alpha_mode == VG_LITE_NORMAL
+       && blit_get_offset(&blits[0], filter, &areas[0], &flipped[0])
+       && blit_get_offset(&blits[1], filter, &areas[1], &flipped[1])) {
+        TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, nullptr, source0));
+        TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, nullptr, source1));
+
+        /* whole pixel translations, each target pixel reads a single texel of each source */
+        const vg_lite_buffer_t * sources[2] = { source0, source1 };
+        const vg_lite_uint32_t * images[2];
+
+        images[0] = picture_decode(ctx, source0, 0, false);
+        if(images[0] != source0->memory) {
+            /* the decode buffer is shared, it is about to be taken by the second source */
+            images[0] = ctx->take_image_buffer(0);
+        }
+        images[1] = picture_decode(ctx, source1, 0, false);
+
+        vg_lite_uint32_t * dest = (vg_lite_uint32_t *)ctx->tvg_target_buffer;
+
+        for(int32_t y = clip.y_min; y < clip.y_max; y++) {
+            const vg_lite_uint32_t * rows[2];
+            int32_t x_min[2];
+            int32_t x_max[2];
+
+            for(int i = 0; i < 2; i++) {
+                const vg_lite_ibox_t * area = &areas[i];
+                bool inside = y >= area->y_min && y < area->y_max;
+                x_min[i] = inside ? MAX(clip.x_min, area->x_min) : clip.x_max;
+                x_max[i] = inside ? MIN(clip.x_max, area->x_max) : clip.x_min;
+
+                /* 'areas' and 'src_box' only differ by the translation and the flip */
+                int32_t src_y = flipped[i] ? area->y_max - 1 - y : y - area->y_min;
+                rows[i] = images[i] + (src_y + blits[i].src_box.y_min) * (int32_t)sources[i]->width
+                          + blits[i].src_box.x_min - area->x_min;
+            }
+
+            vg_lite_uint32_t * dest_row = dest + y * ctx->tvg_target_stride;
+            int32_t lo = MAX(x_min[0], x_min[1]);
+            int32_t hi = MAX(lo, MIN(x_max[0], x_max[1]));
+
+            /* where a single source is drawn */
+            for(int i = 0; i < 2; i++) {
+                blit_blend_row(&ctx->raster, dest_row, rows[i], x_min[i], MIN(x_max[i], lo), blend);
+                blit_blend_row(&ctx->raster, dest_row, rows[i], MAX(x_min[i], hi), x_max[i], blend);
+            }
+
+            /* the decoded images are straight alpha */
+            const vg_lite_uint32_t * row0 = rows[0];
+            const vg_lite_uint32_t * row1 = rows[1];
+
+            for(int32_t x = lo; x < hi; x++) {
+                vg_lite_uint32_t px = pixel_premultiply(row1[x]);
+                vg_lite_uint32_t alpha = A(px);
+
+                if(alpha != 0xFF) {
+                    px += pixel_scale(pixel_premultiply(row0[x]), 0xFF - alpha);
+                    if(!px) {
+                        continue;
+                    }
+                }
+
+                dest_row[x] = raster_blend_pixel(blend, px, dest_row[x], 0xFF);
+            }
+        }
+
+        ctx->target_dirty = true;
+        return Result::Success;
+    }
+
+    vg_lite_polygon_t * polygon = &ctx->polygon;
+    polygon->points.clear();
+    polygon->contours.clear();
+    polygon->extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+    polygon->path_extents = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    /* the cross-fades draw both images over the same area, their common outline gives the edges */
+    bool same_area = memcmp(&blits[0].src_box, &blits[1].src_box, sizeof(vg_lite_ibox_t)) == 0
+                     && memcmp(&blits[0].warp, &blits[1].warp, sizeof(vg_lite_matrix_t)) == 0;
+
+    bool bounded = blit_add_outline(polygon, &blits[0], &clip);
+    if(!same_area) {
+        bounded = blit_add_outline(polygon, &blits[1], &clip) && bounded;
+    }
+
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, &polygon->extents, source0));
+    TVG_CHECK_RETURN_RESULT(canvas_flush_area(ctx, &clip, &polygon->extents, source1));
+
+    vg_lite_sampler_t samplers[2];
+    blit_init_sampler(ctx, &samplers[0], &blits[0], source0, 0, filter, 0);
+    blit_init_sampler(ctx, &samplers[1], &blits[1], source1, 0, filter, 1);
+
+    if(!same_area || !bounded) {
+        /* the union of the outlines is filled, each image must read as transparent outside of its own */
+        samplers[0].mode = VG_LITE_PATTERN_COLOR;
+        samplers[1].mode = VG_LITE_PATTERN_COLOR;
+    }
+
+    vg_lite_raster_paint_t paint = {
+        0, blend, nullptr, 0, 0, 0, 0,
+        &samplers[0], ctx->get_sample_span(target->width, 0),
+        &samplers[1], ctx->get_sample_span(target->width, 1)
+    };
+
+    raster_fill_polygon(&ctx->raster, polygon, VG_LITE_FILL_NON_ZERO, quality_tier_get(VG_LITE_HIGH)->samples, &clip,
+                        &paint, (vg_lite_uint32_t *)ctx->tvg_target_buffer, ctx->tvg_target_stride);
+
+    mip_cache_trim(ctx);
+    ctx->target_dirty = true;
+    return Result::Success;
+}
+
+static bool blit_prepare(vg_lite_blit_t * blit, const vg_lite_buffer_t * source, const vg_lite_rectangle_t * rect,
+                         const vg_lite_matrix_t * matrix)
+{
+    /* false when nothing of the source can be drawn */
+    blit->src_box = { 0, 0, (int32_t)source->width, (int32_t)source->height };
+    blit->warp = matrix ? *matrix : vg_lite_matrix_t { { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, 1, 1, 0 };
+
+    if(rect) {
+        blit->src_box.x_min = MAX(blit->src_box.x_min, rect->x);
+        blit->src_box.y_min = MAX(blit->src_box.y_min, rect->y);
+        blit->src_box.x_max = MIN(blit->src_box.x_max, rect->x + rect->width);
+        blit->src_box.y_max = MIN(blit->src_box.y_max, rect->y + rect->height);
+
+        /* the top left corner of the rect lands on the matrix origin */
+        for(int i = 0; i < 3; i++) {
+            blit->warp.m[i][2] -= blit->warp.m[i][0] * rect->x + blit->warp.m[i][1] * rect->y;
+        }
+    }
+
+    if(blit->src_box.x_min >= blit->src_box.x_max || blit->src_box.y_min >= blit->src_box.y_max) {
+        return false;
+    }
+
+    return vg_lite_matrix_inverse(&blit->inverse, &blit->warp) == VG_LITE_SUCCESS;
+}
+
+static bool blit_get_offset(const vg_lite_blit_t * blit, vg_lite_filter_t filter, vg_lite_ibox_t * area,
+                            bool * flipped)
+{
+    /**
+     * True when the source lands on whole target pixels, 'area' is then where it lands.
+     * A vertical flip, the mirror orientation, still does: the source rows are read backwards.
+     */
+    if(filter == VG_LITE_FILTER_GAUSSIAN) {
+        return false;
+    }
+
+    vg_lite_matrix_class_t matrix_class = matrix_classify(&blit->warp);
+    *flipped = matrix_class == MATRIX_CLASS_SCALE
+               && math_equal(blit->warp.m[0][0], 1.0f) && math_equal(blit->warp.m[1][1], -1.0f);
+
+    if(matrix_class != MATRIX_CLASS_IDENTITY && matrix_class != MATRIX_CLASS_TRANSLATE && !*flipped) {
+        return false;
+    }
+
+    vg_lite_float_t tx = blit->warp.m[0][2];
+    vg_lite_float_t ty = blit->warp.m[1][2];
+    if(fabsf(tx - roundf(tx)) > 1e-3f || fabsf(ty - roundf(ty)) > 1e-3f
+       || fabsf(tx) > (vg_lite_float_t)INT16_MAX || fabsf(ty) > (vg_lite_float_t)INT16_MAX) {
+        return false;
+    }
+
+    int32_t dx = (int32_t)roundf(tx);
+    int32_t dy = (int32_t)roundf(ty);
+
+    if(*flipped) {
+        *area = { blit->src_box.x_min + dx, dy - blit->src_box.y_max, blit->src_box.x_max + dx, dy - blit->src_box.y_min };
+    }
+    else {
+        *area = { blit->src_box.x_min + dx, blit->src_box.y_min + dy, blit->src_box.x_max + dx, blit->src_box.y_max + dy };
+    }
+
+    return true;
+}
+
+static vg_lite_matrix_t * mirror_apply(const vg_lite_ctx * ctx, vg_lite_matrix_t * matrix, vg_lite_float_t height,
+                                       vg_lite_matrix_t * mirrored)
+{
+    /* the bottom to top orientation reads the source area upside down, a vertical flip within its height */
+    if(ctx->mirror == VG_LITE_ORIENTATION_TOP_BOTTOM) {
+        return matrix;
+    }
+
+    *mirrored = matrix ? *matrix : vg_lite_matrix_t { { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, 1, 1, 0 };
+    vg_lite_translate(0, height, mirrored);
+    vg_lite_scale(1, -1, mirrored);
+    return mirrored;
+}
+
+static void blit_blend_row(const vg_lite_raster_t * raster, vg_lite_uint32_t * dest, const vg_lite_uint32_t * src,
+                           int32_t x_min, int32_t x_max, vg_lite_blend_t blend)
+{
+    /* 'src' is straight alpha, both rows are indexed by the target x */
+    vg_lite_global_alpha_t src_mode = raster->src_alpha_mode;
+
+    if((blend != VG_LITE_BLEND_NONE && !blend_is_source_over(blend)) || src_mode != VG_LITE_NORMAL
+       || raster->dest_alpha_mode != VG_LITE_NORMAL) {
+        /* the global alpha of the source is folded into its premultiplication */
+        vg_lite_uint32_t run[64];
+
+        for(int32_t x = x_min; x < x_max; x += 64) {
+            int32_t n = MIN(x_max - x, 64);
+            for(int32_t i = 0; i < n; i++) {
+                run[i] = pixel_premultiply(pixel_global_alpha(src[x + i], src_mode, raster->src_alpha_value));
+            }
+            blend_span(raster, blend, dest + x, run, nullptr, n);
+        }
+        return;
+    }
+
+    for(int32_t x = x_min; x < x_max; x++) {
+        vg_lite_uint32_t px = src[x];
+        vg_lite_uint32_t alpha = A(px);
+
+        if(alpha == 0xFF) {
+            dest[x] = px;
+        }
+        else if(alpha || blend == VG_LITE_BLEND_NONE) {
+            dest[x] = raster_blend_pixel(blend, pixel_premultiply(px), dest[x], 0xFF);
+        }
+    }
+}
+
+static bool blit_add_outline(vg_lite_polygon_t * polygon, const vg_lite_blit_t * blit, const vg_lite_ibox_t * clip)
+{
+    /**
+     * Adds the transformed source area as a contour winding the same way whatever the
+     * matrix, so that the outlines of several blits add up under the non-zero rule.
+     * Returns false when a corner is behind the horizon, the whole clip is then added.
+     */
+    const vg_lite_fbox_t src_area = {
+        (vg_lite_float_t)blit->src_box.x_min, (vg_lite_float_t)blit->src_box.y_min,
+        (vg_lite_float_t)blit->src_box.x_max, (vg_lite_float_t)blit->src_box.y_max
+    };
+    vg_lite_fbox_t area;
+    vg_lite_matrix_transform_bbox(&blit->warp, &src_area.x_min, &area.x_min, 1);
 
-            case VG_LITE_A8: {
-                    conv_alpha8_to_bgra8888.convert(&target, source, color);
-                }
-                break;
+    bool bounded = area.x_min > -FLT_MAX;
+    const vg_lite_fbox_t clip_area = {
+        (vg_lite_float_t)clip->x_min, (vg_lite_float_t)clip->y_min,
+        (vg_lite_float_t)clip->x_max, (vg_lite_float_t)clip->y_max
+    };
+    const vg_lite_fbox_t * outline = bounded ? &src_area : &clip_area;
 
-            case VG_LITE_L8: {
-                    conv_l8_to_bgra8888.convert(&target, source);
-                }
-                break;
+    vg_lite_fpoint_t corners[4] = {
+        { outline->x_min, outline->y_min },
+        { outline->x_max, outline->y_min },
+        { outline->x_max, outline->y_max },
+        { outline->x_min, outline->y_max },
+    };
 
-            case VG_LITE_BGRX8888: {
-                    conv_bgrx8888_to_bgra8888.convert(&target, source);
-                }
-                break;
+    if(bounded) {
+        vg_lite_matrix_transform_points(&blit->warp, &corners[0].x, &corners[0].x, 4);
+    }
 
-            case VG_LITE_BGR888: {
-                    conv_bgr888_to_bgra8888.convert(&target, source);
-                }
-                break;
+    vg_lite_float_t area2 = 0;
+    for(int i = 0; i < 4; i++) {
+        const vg_lite_fpoint_t * a = &corners[i];
+        const vg_lite_fpoint_t * b = &corners[(i + 1) % 4];
+        area2 += a->x * b->y - b->x * a->y;
+    }
 
-            case VG_LITE_BGRA5658: {
-                    conv_bgra5658_to_bgra8888.convert(&target, source);
-                }
-                break;
+    fbox_add_point(&polygon->path_extents, src_area.x_min, src_area.y_min);
+    fbox_add_point(&polygon->path_extents, src_area.x_max, src_area.y_max);
 
-            case VG_LITE_BGR565: {
-                    conv_bgr565_to_bgra8888.convert(&target, source);
-                }
-                break;
+    /* a mirroring matrix turns the contour around */
+    polygon_begin_contour(polygon, corners[0]);
+    for(int i = 1; i < 4; i++) {
+        polygon_add_point(polygon, corners[area2 < 0 ? 4 - i : i]);
+    }
+    polygon->contours.back().closed = true;
 
-            case VG_LITE_BGRA5551: {
-                    conv_bgra5551_to_bgra8888.convert(&target, source);
-                }
-                break;
+    return bounded;
+}
 
-            case VG_LITE_BGRA4444: {
-                    conv_bgra4444_to_bgra8888.convert(&target, source);
-                }
-                break;
+static void blit_init_sampler(vg_lite_ctx * ctx, vg_lite_sampler_t * sampler, const vg_lite_blit_t * blit,
+                              const vg_lite_buffer_t * source, vg_lite_color_t color, vg_lite_filter_t filter,
+                              int slot)
+{
+    /* the canvas must have been flushed, the source may be decoded */
+    vg_lite_uint32_t level = mip_get_level(source, &blit->warp, filter);
+
+    if(level) {
+        /* a smaller copy of the source takes the place of most of the minification */
+        const vg_lite_mip_level_t * mip = mip_cache_get(ctx, source, color, level, slot);
+        int32_t size = 1 << level;
+        vg_lite_ibox_t mip_box = {
+            blit->src_box.x_min >> level,
+            blit->src_box.y_min >> level,
+            MIN((blit->src_box.x_max + size - 1) >> level, (int32_t)mip->width),
+            MIN((blit->src_box.y_max + size - 1) >> level, (int32_t)mip->height)
+        };
 
-            case VG_LITE_BGRA2222: {
-                    conv_bgra2222_to_bgra8888.convert(&target, source);
-                }
-                break;
+        sampler_init(ctx, sampler, mip->pixels.data(), (int32_t)mip->width, &mip_box, filter);
+        sampler->inverse = blit->inverse;
+        for(int i = 0; i < 3; i++) {
+            sampler->inverse.m[0][i] /= size;
+            sampler->inverse.m[1][i] /= size;
+        }
+    }
+    else {
+        sampler_init(ctx, sampler, sampler_prepare_image(ctx, source, color, &blit->src_box, slot),
+                     (int32_t)source->width, &blit->src_box, filter);
+        sampler->inverse = blit->inverse;
+    }
+}
 
-#if LV_VG_LITE_THORVG_YUV_SUPPORT
-            case VG_LITE_NV12: {
-                    libyuv::NV12ToARGB((const uint8_t *)source->memory, source->stride, (const uint8_t *)source->yuv.uv_memory,
-                                       source->yuv.uv_stride,
-                                       (uint8_t *)image_buffer, source->width * sizeof(vg_lite_uint32_t), width, height);
-                }
-                break;
-#endif
+static Result raster_draw_pattern(vg_lite_ctx * ctx, const vg_lite_buffer_t * target, const vg_lite_path_t * path,
+                                  vg_lite_fill_t fill_rule, const vg_lite_matrix_t * path_matrix,
+                                  const vg_lite_buffer_t * source, const vg_lite_matrix_t * pattern_matrix,
+                                  vg_lite_blend_t blend, vg_lite_pattern_mode_t pattern_mode,
+                                  vg_lite_color_t pattern_color, vg_lite_color_t color, vg_lite_filter_t filter)
+{
+    if(source->width > INT16_MAX || source->height > INT16_MAX) {
+        return Result::NonSupport;
+    }
 
-            case VG_LITE_BGRA8888: {
-                    /* For stride conversion */
-                    conv_bgra8888_to_bgra8888.convert(&target, source);
-                }
-                break;
+    /* the pattern matrix places the image on the target, independently of the path */
+    vg_lite_matrix_t inverse;
+    if(vg_lite_matrix_inverse(&inverse, pattern_matrix) != VG_LITE_SUCCESS) {
+        return Result::NonSupport;
+    }
 
-            case VG_LITE_RGBA8888: {
-                    conv_rgba8888_to_bgra8888.convert(&target, source);
-                }
-                break;
+    /* a pattern read from the target needs the paints pushed before, the path flushes the others */
+    if(source->memory == ctx->target_buffer) {
+        TVG_CHECK_RETURN_RESULT(canvas_flush(ctx));
+    }
 
-            default:
-                LV_LOG_ERROR("unsupported format: %d", source->format);
-                LV_ASSERT(false);
-                break;
-        }
+    vg_lite_ibox_t box = { 0, 0, (int32_t)source->width, (int32_t)source->height };
+    vg_lite_sampler_t sampler;
+    sampler_init(ctx, &sampler, sampler_prepare_image(ctx, source, color, &box, 0), (int32_t)source->width, &box,
+                 filter);
+    sampler.inverse = inverse;
+
+    /* the coordinates are wrapped per texel in the span loop, a small tile covers any path */
+    switch(pattern_mode) {
+        case VG_LITE_PATTERN_PAD:
+        case VG_LITE_PATTERN_REPEAT:
+        case VG_LITE_PATTERN_REFLECT:
+            sampler.mode = pattern_mode;
+            break;
 
-        /* multiply color */
-        if(source->image_mode == VG_LITE_MULTIPLY_IMAGE_MODE && !VG_LITE_IS_ALPHA_FORMAT(source->format)) {
-            vg_color32_t * dest = (vg_color32_t *)image_buffer;
-            vg_lite_uint32_t px_size = width * height;
-            while(px_size--) {
-                dest->alpha = UDIV255(dest->alpha * A(color));
-                dest->red = UDIV255(dest->red * B(color));
-                dest->green = UDIV255(dest->green * G(color));
-                dest->blue = UDIV255(dest->blue * R(color));
-                dest++;
-            }
-        }
+        default:
+            sampler.mode = VG_LITE_PATTERN_COLOR;
+            sampler.border = color_premultiply(pattern_color);
+            break;
     }
 
-#if LV_VG_LITE_THORVG_USE_RELEASE
-    TVG_CHECK_RETURN_RESULT(picture->load((uint32_t *)image_buffer, source->width, source->height, true));
-#else
-    TVG_CHECK_RETURN_RESULT(picture->load((uint32_t *)image_buffer, source->width, source->height, false, true));
-#endif
+    vg_lite_raster_paint_t paint = { 0, blend, nullptr, 0, 0, 0, 0, &sampler, ctx->get_sample_span(target->width, 0) };
 
-    return Result::Success;
-}
+    Result raster_res = raster_draw_rrect(ctx, target, path, path_matrix, &paint);
+    if(raster_res == Result::NonSupport) {
+        raster_res = raster_draw_path(ctx, target, path, fill_rule, path_matrix, &paint);
+    }
 
+    return raster_res;
+}
 static void ClampColor(FLOATVECTOR4 Source, FLOATVECTOR4 Target, uint8_t Premultiplied)
 {
     vg_lite_float_t colorMax;
@@ -2977,65 +8007,465 @@ static void get_format_bytes(vg_lite_buffer_format_t format,
     }
 }
 
-static vg_lite_fpoint_t matrix_transform_point(const vg_lite_matrix_t * matrix, const vg_lite_fpoint_t * point)
+static bool ramp_image_owned(vg_lite_ctx * ctx, const void * grad, const vg_lite_buffer_t * image)
 {
-    vg_lite_fpoint_t p;
-    p.x = (vg_lite_float_t)(point->x * matrix->m[0][0] + point->y * matrix->m[0][1] + matrix->m[0][2]);
-    p.y = (vg_lite_float_t)(point->x * matrix->m[1][0] + point->y * matrix->m[1][1] + matrix->m[1][2]);
-    return p;
+    /* the struct may come uninitialized from the application, its pointers are only compared */
+    if(image->handle == NULL || image->handle != image->memory) {
+        return false;
+    }
+
+    auto it = ctx->ramp_images.find(image->memory);
+    return it != ctx->ramp_images.end() && it->second == grad;
 }
 
-static bool vg_lite_matrix_inverse(vg_lite_matrix_t * result, const vg_lite_matrix_t * matrix)
+static vg_lite_error_t ramp_image_prepare(vg_lite_ctx * ctx, const void * grad, vg_lite_buffer_t * image,
+                                          vg_lite_uint32_t width)
 {
-    vg_lite_float_t det00, det01, det02;
-    vg_lite_float_t d;
-    bool is_affine;
+    vg_lite_error_t error = VG_LITE_SUCCESS;
 
-    /* Test for identity matrix. */
-    if(matrix == NULL) {
-        result->m[0][0] = 1.0f;
-        result->m[0][1] = 0.0f;
-        result->m[0][2] = 0.0f;
-        result->m[1][0] = 0.0f;
-        result->m[1][1] = 1.0f;
-        result->m[1][2] = 0.0f;
-        result->m[2][0] = 0.0f;
-        result->m[2][1] = 0.0f;
-        result->m[2][2] = 1.0f;
+    /* updating a gradient keeps the ramp image it allocated, only a new width reallocates it */
+    if(ramp_image_owned(ctx, grad, image)) {
+        if(image->width == width && image->height == 1 && image->format == VG_LITE_ABGR8888) {
+            return VG_LITE_SUCCESS;
+        }
 
-        /* Success. */
-        return true;
+        VG_LITE_RETURN_ERROR(vg_lite_free(image));
     }
 
-    det00 = (matrix->m[1][1] * matrix->m[2][2]) - (matrix->m[2][1] * matrix->m[1][2]);
-    det01 = (matrix->m[2][0] * matrix->m[1][2]) - (matrix->m[1][0] * matrix->m[2][2]);
-    det02 = (matrix->m[1][0] * matrix->m[2][1]) - (matrix->m[2][0] * matrix->m[1][1]);
+    memset(image, 0, sizeof(vg_lite_buffer_t));
+    image->width = width;
+    image->height = 1;
+    image->stride = 0;
+    image->image_mode = VG_LITE_NONE_IMAGE_MODE;
+    image->format = VG_LITE_ABGR8888;
 
-    /* Compute determinant. */
-    d = (matrix->m[0][0] * det00) + (matrix->m[0][1] * det01) + (matrix->m[0][2] * det02);
+    VG_LITE_RETURN_ERROR(vg_lite_allocate(image));
+    ctx->ramp_images[image->memory] = grad;
+    return VG_LITE_SUCCESS;
+}
 
-    /* Return 0 if there is no inverse matrix. */
-    if(d == 0.0f)
-        return false;
+static void ramp_image_release(vg_lite_ctx * ctx, const void * grad, vg_lite_buffer_t * image)
+{
+    /* a block of the pool, it can't fail to be freed */
+    if(ramp_image_owned(ctx, grad, image)) {
+        vg_lite_free(image);
+    }
+}
 
-    /* Compute reciprocal. */
-    d = 1.0f / d;
+static vg_lite_uint32_t ramp_get_width(const vg_lite_color_ramp_t * ramp, vg_lite_uint32_t length,
+                                       vg_lite_float_t extent)
+{
+    const vg_lite_uint32_t max_common = LV_VG_LITE_THORVG_GRAD_RAMP_MAX_WIDTH - 1;
+
+    /* Find the common denominator of the color ramp stops. */
+    vg_lite_uint32_t common = extent < 1 ? 1 : (vg_lite_uint32_t)(MIN(extent, (vg_lite_float_t)max_common));
 
-    /* Determine if the matrix is affine. */
-    is_affine = (matrix->m[2][0] == 0.0f) && (matrix->m[2][1] == 0.0f) && (matrix->m[2][2] == 1.0f);
+    for(vg_lite_uint32_t i = 0; i < length && common < max_common; ++i) {
+        if(ramp[i].stop != 0.0f) {
+            vg_lite_float_t mul = common * ramp[i].stop;
+            vg_lite_float_t frac = mul - (vg_lite_float_t)floor(mul);
+            if(frac > 0.00013f) { /* Suppose error for zero is 0.00013 */
+                common = MAX(common, (vg_lite_uint32_t)(1.0f / frac + 0.5f));
+            }
+        }
+    }
 
-    result->m[0][0] = d * det00;
-    result->m[0][1] = d * ((matrix->m[2][1] * matrix->m[0][2]) - (matrix->m[0][1] * matrix->m[2][2]));
-    result->m[0][2] = d * ((matrix->m[0][1] * matrix->m[1][2]) - (matrix->m[1][1] * matrix->m[0][2]));
-    result->m[1][0] = d * det01;
-    result->m[1][1] = d * ((matrix->m[0][0] * matrix->m[2][2]) - (matrix->m[2][0] * matrix->m[0][2]));
-    result->m[1][2] = d * ((matrix->m[1][0] * matrix->m[0][2]) - (matrix->m[0][0] * matrix->m[1][2]));
-    result->m[2][0] = is_affine ? 0.0f : d * det02;
-    result->m[2][1] = is_affine ? 0.0f : d * ((matrix->m[2][0] * matrix->m[0][1]) - (matrix->m[0][0] * matrix->m[2][1]));
-    result->m[2][2] = is_affine ? 1.0f : d * ((matrix->m[0][0] * matrix->m[1][1]) - (matrix->m[1][0] * matrix->m[0][1]));
+    /* past the cap the stops fall between the texels, the ramp is resampled from the stop list */
+    return MIN(common, max_common) + 1;
+}
 
-    /* Success. */
-    return true;
+static vg_lite_uint32_t ramp_convert(vg_lite_ramp_stop_t * stops, const vg_lite_color_ramp_t * ramp,
+                                     vg_lite_uint32_t length, vg_lite_uint32_t width, bool pre_multiplied)
+{
+    vg_lite_float_t scale = (vg_lite_float_t)(width - 1);
+
+    for(vg_lite_uint32_t i = 0; i < length; i++) {
+        vg_lite_float_t alpha = ramp[i].alpha;
+        vg_lite_float_t mul = pre_multiplied ? alpha : 1.0f;
+
+        /* the ramp image is read as the bytes A, B, G, R */
+        stops[i].pos = ramp[i].stop * scale;
+        stops[i].color = (vg_lite_uint32_t)PackColorComponent(alpha)
+                         | (vg_lite_uint32_t)PackColorComponent(ramp[i].blue * mul) << 8
+                         | (vg_lite_uint32_t)PackColorComponent(ramp[i].green * mul) << 16
+                         | (vg_lite_uint32_t)PackColorComponent(ramp[i].red * mul) << 24;
+    }
+
+    return length;
+}
+
+static inline void ramp_fill_span(vg_lite_uint32_t * dest, vg_lite_uint32_t count, vg_lite_uint32_t c0,
+                                  vg_lite_uint32_t c1, vg_lite_float_t u, vg_lite_float_t du)
+{
+    /**
+     * The channels are stepped as 8.16 fixed point, two of them in each 64-bit word:
+     * bytes 0 and 2 in the first word, bytes 1 and 3 in the second one.
+     * The steps are truncated toward zero and the increments kept apart from the decrements,
+     * so a lane stays in 0..255 over the span and never carries into its neighbour.
+     * It runs once per texel of an updated ramp, not per pixel, so it has no NEON or SSE2 version.
+     */
+    uint64_t acc[2] = { 0, 0 };
+    uint64_t inc[2] = { 0, 0 };
+    uint64_t dec[2] = { 0, 0 };
+
+    u = CLAMP(u, 0.0f, 1.0f);
+
+    for(int32_t ch = 0; ch < 4; ch++) {
+        int32_t from = (c0 >> (ch * 8)) & 0xff;
+        int32_t to = (c1 >> (ch * 8)) & 0xff;
+        vg_lite_float_t delta = (vg_lite_float_t)((to - from) * 65536);
+        int32_t start = from * 65536 + (int32_t)(delta * u) + 32768;
+        int32_t step = (int32_t)(delta * du);
+        int32_t word = ch & 1;
+        int32_t shift = (ch >> 1) * 32;
+
+        acc[word] |= (uint64_t)start << shift;
+        if(step >= 0) {
+            inc[word] |= (uint64_t)step << shift;
+        }
+        else {
+            dec[word] |= (uint64_t)(-step) << shift;
+        }
+    }
+
+    for(vg_lite_uint32_t i = 0; i < count; i++) {
+        dest[i] = (vg_lite_uint32_t)((acc[0] >> 16) & 0xff)
+                  | (vg_lite_uint32_t)((acc[1] >> 16) & 0xff) << 8
+                  | (vg_lite_uint32_t)((acc[0] >> 48) & 0xff) << 16
+                  | (vg_lite_uint32_t)((acc[1] >> 48) & 0xff) << 24;
+
+        acc[0] = acc[0] + inc[0] - dec[0];
+        acc[1] = acc[1] + inc[1] - dec[1];
+    }
+}
+
+static void ramp_generate(vg_lite_uint32_t * dest, vg_lite_uint32_t width, const vg_lite_ramp_stop_t * stops,
+                          vg_lite_uint32_t count)
+{
+    vg_lite_uint32_t i = 0;
+
+    /* the texels up to the first stop take its color */
+    while(i < width && (vg_lite_float_t)i <= stops[0].pos) {
+        dest[i++] = stops[0].color;
+    }
+
+    for(vg_lite_uint32_t s = 0; s + 1 < count && i < width; s++) {
+        const vg_lite_ramp_stop_t * s0 = &stops[s];
+        const vg_lite_ramp_stop_t * s1 = &stops[s + 1];
+
+        /* the texels in (s0, s1], none between two stops at the same position */
+        vg_lite_uint32_t end = i;
+        while(end < width && (vg_lite_float_t)end <= s1->pos) {
+            end++;
+        }
+
+        if(end > i) {
+            vg_lite_float_t du = 1.0f / (s1->pos - s0->pos);
+            ramp_fill_span(dest + i, end - i, s0->color, s1->color, ((vg_lite_float_t)i - s0->pos) * du, du);
+            i = end;
+        }
+    }
+
+    while(i < width) {
+        dest[i++] = stops[count - 1].color;
+    }
+}
+
+static void ramp_update(vg_lite_ctx * ctx, vg_lite_buffer_t * image, const vg_lite_ramp_stop_t * stops,
+                        vg_lite_uint32_t count, vg_lite_uint32_t width)
+{
+    vg_lite_uint32_t * dest = (vg_lite_uint32_t *)image->memory;
+
+    if(count == 0) {
+        memset(dest, 0, width * sizeof(vg_lite_uint32_t));
+        return;
+    }
+
+#if LV_VG_LITE_THORVG_GRAD_CACHE_CNT
+    /* FNV-1a of the stops, the widgets of a theme share a handful of gradients */
+    const uint8_t * data = (const uint8_t *)stops;
+    vg_lite_uint32_t hash = 0x811C9DC5;
+    for(size_t i = 0; i < count * sizeof(vg_lite_ramp_stop_t); i++) {
+        hash = (hash ^ data[i]) * 0x01000193;
+    }
+
+    auto & cache = ctx->ramp_cache;
+
+    for(auto it = cache.begin(); it != cache.end(); ++it) {
+        if(it->hash == hash && it->width == width && it->stops.size() == count
+           && memcmp(it->stops.data(), stops, count * sizeof(vg_lite_ramp_stop_t)) == 0) {
+            cache.splice(cache.begin(), cache, it);
+            memcpy(dest, it->texels.data(), width * sizeof(vg_lite_uint32_t));
+            return;
+        }
+    }
+
+    if(cache.size() < LV_VG_LITE_THORVG_GRAD_CACHE_CNT) {
+        cache.emplace_front();
+    }
+    else {
+        cache.splice(cache.begin(), cache, std::prev(cache.end()));
+    }
+
+    vg_lite_ramp_t * ramp = &cache.front();
+    ramp->hash = hash;
+    ramp->width = width;
+    ramp->stops.assign(stops, stops + count);
+    ramp->texels.resize(width);
+
+    ramp_generate(ramp->texels.data(), width, stops, count);
+    memcpy(dest, ramp->texels.data(), width * sizeof(vg_lite_uint32_t));
+#else
+    LV_UNUSED(ctx);
+    ramp_generate(dest, width, stops, count);
+#endif
+}
+
+static Result linear_grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad)
+{
+    auto linear = (const vg_lite_ext_linear_gradient_t *)grad;
+
+    auto linearGrad = LinearGradient::gen();
+    TVG_CHECK_RETURN_RESULT(linearGrad->linear(linear->linear_grad.X0, linear->linear_grad.Y0, linear->linear_grad.X1,
+                                               linear->linear_grad.Y1));
+    TVG_CHECK_RETURN_RESULT(linearGrad->spread(fill_spread_conv(linear->spread_mode)));
+
+    tvg::Fill::ColorStop colorStops[VLC_MAX_COLOR_RAMP_STOPS];
+    for(vg_lite_uint32_t i = 0; i < linear->ramp_length; i++) {
+        colorStops[i].offset = linear->color_ramp[i].stop;
+        colorStops[i].r = linear->color_ramp[i].red * 255.0f;
+        colorStops[i].g = linear->color_ramp[i].green * 255.0f;
+        colorStops[i].b = linear->color_ramp[i].blue * 255.0f;
+        colorStops[i].a = linear->color_ramp[i].alpha * 255.0f;
+    }
+    TVG_CHECK_RETURN_RESULT(linearGrad->colorStops(colorStops, linear->ramp_length));
+
+    fill = std::move(linearGrad);
+    return Result::Success;
+}
+
+static Result linear_grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix)
+{
+    LV_UNUSED(grad);
+    return fill->transform(matrix_conv(grad_matrix));
+}
+
+static Result radial_grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad)
+{
+    auto radial = (const vg_lite_radial_gradient_t *)grad;
+
+    auto radialGrad = RadialGradient::gen();
+    TVG_CHECK_RETURN_RESULT(radialGrad->radial(radial->radial_grad.cx, radial->radial_grad.cy, radial->radial_grad.r));
+    TVG_CHECK_RETURN_RESULT(radialGrad->spread(fill_spread_conv(radial->spread_mode)));
+
+    tvg::Fill::ColorStop colorStops[VLC_MAX_COLOR_RAMP_STOPS];
+    for(vg_lite_uint32_t i = 0; i < radial->ramp_length; i++) {
+        colorStops[i].offset = radial->color_ramp[i].stop;
+        colorStops[i].r = radial->color_ramp[i].red * 255.0f;
+        colorStops[i].g = radial->color_ramp[i].green * 255.0f;
+        colorStops[i].b = radial->color_ramp[i].blue * 255.0f;
+        colorStops[i].a = radial->color_ramp[i].alpha * 255.0f;
+    }
+    TVG_CHECK_RETURN_RESULT(radialGrad->colorStops(colorStops, radial->ramp_length));
+
+    fill = std::move(radialGrad);
+    return Result::Success;
+}
+
+static Result radial_grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix)
+{
+    LV_UNUSED(grad);
+    return fill->transform(matrix_conv(grad_matrix));
+}
+
+static Result grad_gen_fill(std::unique_ptr<Fill> & fill, const void * grad)
+{
+    auto linear = (const vg_lite_linear_gradient_t *)grad;
+
+    auto linearGrad = LinearGradient::gen();
+    TVG_CHECK_RETURN_RESULT(linearGrad->spread(FillSpread::Pad));
+
+    tvg::Fill::ColorStop colorStops[VLC_MAX_GRADIENT_STOPS];
+    for(vg_lite_uint32_t i = 0; i < linear->count; i++) {
+        colorStops[i].offset = linear->stops[i] / 255.0f;
+        colorStops[i].r = R(linear->colors[i]);
+        colorStops[i].g = G(linear->colors[i]);
+        colorStops[i].b = B(linear->colors[i]);
+        colorStops[i].a = A(linear->colors[i]);
+    }
+    TVG_CHECK_RETURN_RESULT(linearGrad->colorStops(colorStops, linear->count));
+
+    fill = std::move(linearGrad);
+    return Result::Success;
+}
+
+static Result grad_set_matrix(Fill * fill, const void * grad, const vg_lite_matrix_t * grad_matrix)
+{
+    LV_UNUSED(grad);
+
+    /* the gradient runs along the x axis of its matrix, over 256 units */
+    vg_lite_fpoint_t p1 = {0.0f, 0.0f};
+    vg_lite_fpoint_t p2 = {1.0f, 0};
+
+    vg_lite_fpoint_t p1_trans = matrix_transform_point(grad_matrix, &p1);
+    vg_lite_fpoint_t p2_trans = matrix_transform_point(grad_matrix, &p2);
+    float dx = (p2_trans.x - p1_trans.x);
+    float dy = (p2_trans.y - p1_trans.y);
+    float scale = sqrtf(dx * dx + dy * dy);
+    float angle = (float)(atan2f(dy, dx));
+    float dlen = 256 * scale;
+    float x_min = grad_matrix->m[0][2];
+    float y_min = grad_matrix->m[1][2];
+    float x_max = x_min + dlen * cosf(angle);
+    float y_max = y_min + dlen * sinf(angle);
+    LV_LOG_TRACE("linear gradient {%.2f, %.2f} ~ {%.2f, %.2f}", x_min, y_min, x_max, y_max);
+
+    return static_cast<LinearGradient *>(fill)->linear(x_min, y_min, x_max, y_max);
+}
+
+static inline vg_lite_uint32_t hash_bytes(vg_lite_uint32_t hash, const void * data, size_t size)
+{
+    /* FNV-1a */
+    const uint8_t * bytes = (const uint8_t *)data;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static vg_lite_uint32_t linear_grad_signature(const void * grad)
+{
+    auto linear = (const vg_lite_ext_linear_gradient_t *)grad;
+    vg_lite_uint32_t length = MIN(linear->converted_length, (vg_lite_uint32_t)(VLC_MAX_COLOR_RAMP_STOPS + 2));
+
+    vg_lite_uint32_t hash = hash_bytes(0x811C9DC5, &linear->linear_grad, sizeof(linear->linear_grad));
+    hash = hash_bytes(hash, &length, sizeof(length));
+    hash = hash_bytes(hash, linear->converted_ramp, length * sizeof(vg_lite_color_ramp_t));
+    hash = hash_bytes(hash, &linear->pre_multiplied, sizeof(linear->pre_multiplied));
+    return hash_bytes(hash, &linear->spread_mode, sizeof(linear->spread_mode));
+}
+
+static vg_lite_uint32_t radial_grad_signature(const void * grad)
+{
+    auto radial = (const vg_lite_radial_gradient_t *)grad;
+    vg_lite_uint32_t length = MIN(radial->converted_length, (vg_lite_uint32_t)(VLC_MAX_COLOR_RAMP_STOPS + 2));
+
+    vg_lite_uint32_t hash = hash_bytes(0x811C9DC5, &radial->radial_grad, sizeof(radial->radial_grad));
+    hash = hash_bytes(hash, &length, sizeof(length));
+    hash = hash_bytes(hash, radial->converted_ramp, length * sizeof(vg_lite_color_ramp_t));
+    hash = hash_bytes(hash, &radial->pre_multiplied, sizeof(radial->pre_multiplied));
+    return hash_bytes(hash, &radial->spread_mode, sizeof(radial->spread_mode));
+}
+
+static vg_lite_uint32_t grad_signature(const void * grad)
+{
+    auto linear = (const vg_lite_linear_gradient_t *)grad;
+    vg_lite_uint32_t count = MIN(linear->count, (vg_lite_uint32_t)VLC_MAX_GRADIENT_STOPS);
+
+    vg_lite_uint32_t hash = hash_bytes(0x811C9DC5, &count, sizeof(count));
+    hash = hash_bytes(hash, linear->colors, count * sizeof(linear->colors[0]));
+    return hash_bytes(hash, linear->stops, count * sizeof(linear->stops[0]));
+}
+
+static vg_lite_fill_cache_t * fill_cache_find(vg_lite_ctx * ctx, const void * grad, fill_sign_cb_t sign)
+{
+    /* the address alone may be a gradient edited in place or a new one in reused memory */
+    auto & cache = ctx->fill_cache;
+
+    for(auto it = cache.begin(); it != cache.end(); ++it) {
+        if(it->grad == grad) {
+            if(it->signature != sign(grad)) {
+                cache.erase(it);
+                return nullptr;
+            }
+
+            cache.splice(cache.begin(), cache, it);
+            return &cache.front();
+        }
+    }
+
+    return nullptr;
+}
+
+static vg_lite_fill_cache_t * fill_cache_update(vg_lite_ctx * ctx, const void * grad, fill_gen_cb_t gen,
+                                                fill_sign_cb_t sign)
+{
+#if LV_VG_LITE_THORVG_GRAD_CACHE_CNT
+    auto & cache = ctx->fill_cache;
+    fill_cache_drop(ctx, grad);
+
+    if(cache.size() < LV_VG_LITE_THORVG_GRAD_CACHE_CNT) {
+        cache.emplace_front();
+    }
+    else {
+        cache.splice(cache.begin(), cache, std::prev(cache.end()));
+    }
+
+    vg_lite_fill_cache_t * entry = &cache.front();
+    entry->grad = grad;
+    entry->signature = sign(grad);
+    entry->matrix_valid = false;
+    entry->ramp.clear();
+
+    if(gen(entry->fill, grad) != Result::Success) {
+        cache.pop_front();
+        return nullptr;
+    }
+
+    return entry;
+#else
+    LV_UNUSED(ctx);
+    LV_UNUSED(grad);
+    LV_UNUSED(gen);
+    LV_UNUSED(sign);
+    return nullptr;
+#endif
+}
+
+static void fill_cache_drop(vg_lite_ctx * ctx, const void * grad)
+{
+    ctx->fill_cache.remove_if([grad](const vg_lite_fill_cache_t & entry) {
+        return entry.grad == grad;
+    });
+}
+
+static Result fill_cache_get(vg_lite_ctx * ctx, std::unique_ptr<Fill> & fill, const void * grad,
+                             const vg_lite_matrix_t * user_matrix, const vg_lite_matrix_t * path_matrix,
+                             fill_gen_cb_t gen, fill_sign_cb_t sign, fill_set_matrix_cb_t set_matrix)
+{
+    vg_lite_matrix_t grad_matrix;
+    vg_lite_fill_cache_t * cache = fill_cache_find(ctx, grad, sign);
+
+    if(!cache) {
+        /* not updated since it was set, the stops are converted for this draw only */
+        TVG_CHECK_RETURN_RESULT(vg_lite_grad_matrix_conv(&grad_matrix, user_matrix, path_matrix));
+        TVG_CHECK_RETURN_RESULT(gen(fill, grad));
+        return set_matrix(fill.get(), grad, &grad_matrix);
+    }
+
+    /* the matrix inverse is only redone when the gradient or the path matrix changes */
+    if(!cache->matrix_valid
+       || memcmp(cache->grad_matrix.m, user_matrix->m, sizeof(user_matrix->m)) != 0
+       || memcmp(cache->path_matrix.m, path_matrix->m, sizeof(path_matrix->m)) != 0) {
+        cache->matrix_valid = false;
+        TVG_CHECK_RETURN_RESULT(vg_lite_grad_matrix_conv(&grad_matrix, user_matrix, path_matrix));
+        TVG_CHECK_RETURN_RESULT(set_matrix(cache->fill.get(), grad, &grad_matrix));
+        cache->grad_matrix = *user_matrix;
+        cache->path_matrix = *path_matrix;
+        cache->matrix_valid = true;
+    }
+
+    fill.reset(cache->fill->duplicate());
+    return fill ? Result::Success : Result::FailedAllocation;
+}
+
+static vg_lite_fpoint_t matrix_transform_point(const vg_lite_matrix_t * matrix, const vg_lite_fpoint_t * point)
+{
+    vg_lite_fpoint_t p;
+    p.x = (vg_lite_float_t)(point->x * matrix->m[0][0] + point->y * matrix->m[0][1] + matrix->m[0][2]);
+    p.y = (vg_lite_float_t)(point->x * matrix->m[1][0] + point->y * matrix->m[1][1] + matrix->m[1][2]);
+    return p;
 }
 
 static void vg_lite_matrix_multiply(vg_lite_matrix_t * matrix, const vg_lite_matrix_t * mult)
@@ -3071,7 +8501,25 @@ static Result vg_lite_grad_matrix_conv(vg_lite_matrix_t * result, const vg_lite_
      * =>
      * gradient_matrix = inv(path_matrix) * matrix_out
      */
-    if(!vg_lite_matrix_inverse(result, path_matrix)) {
+    switch(matrix_classify(path_matrix)) {
+        case MATRIX_CLASS_IDENTITY:
+            *result = *grad_matrix;
+            return Result::Success;
+
+        case MATRIX_CLASS_TRANSLATE:
+            /* the inverse is the opposite translation */
+            *result = *grad_matrix;
+            for(int i = 0; i < 3; i++) {
+                result->m[0][i] -= path_matrix->m[0][2] * grad_matrix->m[2][i];
+                result->m[1][i] -= path_matrix->m[1][2] * grad_matrix->m[2][i];
+            }
+            return Result::Success;
+
+        default:
+            break;
+    }
+
+    if(vg_lite_matrix_inverse(result, path_matrix) != VG_LITE_SUCCESS) {
         return Result::InvalidArguments;
     }
 
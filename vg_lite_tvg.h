@@ -0,0 +1,32 @@
+/**
+ * @file vg_lite_tvg.h
+ *
+ * Entry points of the ThorVG based simulator, beyond the vg_lite.h API.
+ */
+
+#ifndef VG_LITE_TVG_H
+#define VG_LITE_TVG_H
+
+#include "vg_lite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Create the simulator context, the 'gpu_init()' of LV_VG_LITE_USE_GPU_INIT. */
+void gpu_init(void);
+
+/* Release the simulator context and the buffers it keeps for reuse. */
+void gpu_deinit(void);
+
+/* Number of draws skipped because they fall outside of the target or the scissor. */
+vg_lite_uint32_t gpu_get_culled_count(void);
+
+/* Most bytes held at once by the buffers of vg_lite_allocate(), vg_lite_get_mem_size() gives the current ones. */
+vg_lite_uint32_t gpu_get_mem_peak(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VG_LITE_TVG_H */